@@ -1131,17 +1131,34 @@ analyzeNegNot(INS ins, Kind kind) {
     (AFUNPTR)instrumentNegNotMem);
 }
 
+// Source line of addr, or 0 without debug information. Instrumentation
+// routines already run with the client lock held.
+static INT32
+getSourceLine(ADDRINT addr) {
+  INT32 line = 0;
+  PIN_GetSourceLocation(addr, NULL, &line, NULL);
+  return line;
+}
+
 void
 analyzeJcc(INS ins, JccKind jcc_kind, bool inv) {
+  // the taken and fall-through lines are static per branch, so resolve them
+  // once here rather than on every execution
+  INT32 taken_line = 0;
+  if (INS_IsDirectBranchOrCall(ins))
+    taken_line = getSourceLine(INS_DirectBranchOrCallTargetAddress(ins));
+  INT32 not_taken_line = getSourceLine(INS_NextAddress(ins));
+
   INS_InsertCall(ins,
       IPOINT_BEFORE,
       (AFUNPTR)instrumentJcc,
       IARG_FAST_ANALYSIS_CALL,
       IARG_CPU_CONTEXT,
       IARG_BRANCH_TAKEN,
-      IARG_BRANCH_TARGET_ADDR,
       IARG_ARG(jcc_kind),
       IARG_ARG(inv),
+      IARG_ARG(taken_line),
+      IARG_ARG(not_taken_line),
       IARG_END);
 }
 
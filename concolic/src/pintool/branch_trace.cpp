@@ -0,0 +1,95 @@
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "branch_trace.h"
+
+namespace qsym {
+
+namespace {
+
+const char kBranchTraceMagic[8] = {'H', 'U', 'N', 'T', 'B', 'T', 'R', 'C'};
+const uint32_t kBranchTraceVersion = 1;
+const size_t kBranchTraceRecords = 4096;
+const char* kBranchTraceFile = "branch_trace.bin";
+
+bool writeAll(int fd, const void* buf, size_t size) {
+  const char* p = static_cast<const char*>(buf);
+  while (size > 0) {
+    ssize_t written = write(fd, p, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    p += written;
+    size -= written;
+  }
+  return true;
+}
+
+} // namespace
+
+static KNOB<bool> g_opt_branch_trace(KNOB_MODE_WRITEONCE, "pintool",
+    "branch_trace", "0", "Record symbolic branches to branch_trace.bin");
+
+BranchTrace::BranchTrace()
+  : fd_(-1)
+  , records_()
+  , count_(0)
+{}
+
+BranchTrace::~BranchTrace() {
+  flush();
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+void BranchTrace::open(const std::string& out_dir) {
+  if (!g_opt_branch_trace.Value())
+    return;
+
+  if (out_dir.empty()) {
+    LOG_WARN("Branch trace needs an output directory\n");
+    return;
+  }
+
+  std::string path = out_dir + "/" + kBranchTraceFile;
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG_WARN("Cannot open a branch trace: " + path + "\n");
+    return;
+  }
+
+  BranchTraceHeader header;
+  memcpy(header.magic, kBranchTraceMagic, sizeof(header.magic));
+  header.version = kBranchTraceVersion;
+  header.record_size = sizeof(BranchRecord);
+  if (!writeAll(fd_, &header, sizeof(header))) {
+    LOG_WARN("Cannot write a branch trace: " + path + "\n");
+    close(fd_);
+    fd_ = -1;
+    return;
+  }
+
+  records_.resize(kBranchTraceRecords);
+}
+
+void BranchTrace::add(const BranchRecord& record) {
+  if (!enabled())
+    return;
+  records_[count_++] = record;
+  if (count_ == records_.size())
+    flush();
+}
+
+void BranchTrace::flush() {
+  if (!enabled() || count_ == 0)
+    return;
+  if (!writeAll(fd_, &records_[0], count_ * sizeof(BranchRecord)))
+    LOG_WARN("Cannot write a branch trace\n");
+  count_ = 0;
+}
+
+} // namespace qsym
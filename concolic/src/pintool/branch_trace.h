@@ -0,0 +1,66 @@
+#ifndef QSYM_BRANCH_TRACE_H_
+#define QSYM_BRANCH_TRACE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+namespace qsym {
+
+enum BranchVerdict {
+  // the branch was not worth negating
+  BV_NotNegated = 0,
+  BV_Sat,
+  // satisfied only without the path constraints
+  BV_Optimistic,
+  BV_Unsat,
+  // queued for solving in a later batch (-defer_solving)
+  BV_Deferred,
+};
+
+// One symbolic branch, written as-is to <out_dir>/branch_trace.bin after a
+// BranchTraceHeader. Distances are kNoDistance (-1) when unknown.
+struct BranchRecord {
+  uint64_t pc;
+  int32_t taken_line;
+  int32_t not_taken_line;
+  int32_t followed_distance;
+  int32_t negated_distance;
+  uint32_t solving_time;  // us spent in the solver for this branch
+  uint8_t taken;
+  uint8_t verdict;
+  uint16_t reserved;
+};
+
+struct BranchTraceHeader {
+  char magic[8];          // "HUNTBTRC"
+  uint32_t version;
+  uint32_t record_size;
+};
+
+// Fixed-size buffer of BranchRecords behind the -branch_trace knob. Records
+// are appended without formatting and written out in one go when the
+// buffer fills up or the thread finishes, so tracing stays off the
+// target's stdout and costs a copy per branch.
+class BranchTrace {
+public:
+  BranchTrace();
+  ~BranchTrace();
+
+  void open(const std::string& out_dir);
+  bool enabled() const { return fd_ >= 0; }
+
+  void add(const BranchRecord& record);
+  void flush();
+
+private:
+  int fd_;
+  std::vector<BranchRecord> records_;
+  size_t count_;
+};
+
+} // namespace qsym
+
+#endif // QSYM_BRANCH_TRACE_H_
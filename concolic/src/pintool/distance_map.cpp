@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "distance_map.h"
+
+namespace qsym {
+
+DistanceMap::DistanceMap()
+  : target_line_(0)
+  , distances_()
+  , mapped_(NULL)
+  , mapped_size_(0)
+  , header_(NULL)
+  , keys_(NULL)
+  , mapped_distances_(NULL)
+  , reach_(NULL)
+{}
+
+DistanceMap::~DistanceMap() {
+  unmap();
+}
+
+bool DistanceMap::load(const std::string& path, INT32 target_line) {
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (fp == NULL) {
+    LOG_WARN("Cannot open a distance file: " + path + "\n");
+    return false;
+  }
+
+  char magic[sizeof(hunt::kDistanceMagic)];
+  bool is_binary = fread(magic, sizeof(magic), 1, fp) == 1
+    && hunt::isHuntDistanceMagic(magic);
+  fclose(fp);
+
+  target_line_ = target_line;
+  distances_.clear();
+  unmap();
+
+  if (is_binary)
+    return loadBinary(path);
+  return loadText(path);
+}
+
+bool DistanceMap::loadText(const std::string& path) {
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == NULL)
+    return false;
+
+  // Each row is "Line1 Line2 Distance" and every pair is written in both
+  // directions, so keeping the rows whose Line2 is the target gives the
+  // distance from any line to the target. Target-directed tables use
+  // Line2 == kNearestTarget instead.
+  INT32 from, to, distance;
+  while (fscanf(fp, "%d %d %d", &from, &to, &distance) == 3) {
+    if (distance < 0)
+      continue;
+    if (to != (INT32)hunt::kNearestTarget && to != target_line_)
+      continue;
+    distances_[from] = distance;
+  }
+  fclose(fp);
+
+  if (target_line_ > 0)
+    distances_[target_line_] = 0;
+  return true;
+}
+
+bool DistanceMap::loadBinary(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0
+      || (size_t)st.st_size < sizeof(hunt::DistanceHeader)) {
+    close(fd);
+    LOG_WARN("Truncated distance file: " + path + "\n");
+    return false;
+  }
+
+  void* buf = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (buf == MAP_FAILED) {
+    LOG_WARN("Cannot mmap a distance file: " + path + "\n");
+    return false;
+  }
+
+  const hunt::DistanceHeader* header =
+    static_cast<const hunt::DistanceHeader*>(buf);
+  if (!hunt::isValidHuntDistanceHeader(*header, st.st_size)
+      || header->Kind > hunt::DK_Interprocedural) {
+    munmap(buf, st.st_size);
+    LOG_WARN("Unsupported distance file: " + path + "\n");
+    return false;
+  }
+
+  const char* base = static_cast<const char*>(buf);
+  mapped_ = buf;
+  mapped_size_ = st.st_size;
+  header_ = header;
+  keys_ = reinterpret_cast<const uint64_t*>(base + header->KeyOffset);
+  mapped_distances_ =
+    reinterpret_cast<const int32_t*>(base + header->DistanceOffset);
+  if (header->ReachLines != 0)
+    reach_ = reinterpret_cast<const uint64_t*>(base + header->ReachOffset);
+  return true;
+}
+
+void DistanceMap::unmap() {
+  if (mapped_ != NULL)
+    munmap(mapped_, mapped_size_);
+  mapped_ = NULL;
+  mapped_size_ = 0;
+  header_ = NULL;
+  keys_ = NULL;
+  mapped_distances_ = NULL;
+  reach_ = NULL;
+}
+
+size_t DistanceMap::size() const {
+  if (isMapped())
+    return header_->NumEntries;
+  return distances_.size();
+}
+
+INT32 DistanceMap::findMapped(uint64_t key) const {
+  const uint64_t* end = keys_ + header_->NumEntries;
+  const uint64_t* it = std::lower_bound(keys_, end, key);
+  if (it == end || *it != key)
+    return kNoDistance;
+  INT32 distance = mapped_distances_[it - keys_];
+  return distance < 0 ? kNoDistance : distance;
+}
+
+INT32 DistanceMap::getDistance(INT32 line) const {
+  // no debug information for this address
+  if (line <= 0)
+    return kNoDistance;
+
+  if (isMapped()) {
+    if (header_->Kind != hunt::DK_Pairwise)
+      return findMapped(hunt::huntDistanceKey(line, hunt::kNearestTarget));
+    if (line == target_line_)
+      return 0;
+    return findMapped(hunt::huntDistanceKey(line, target_line_));
+  }
+
+  auto it = distances_.find(line);
+  if (it == distances_.end())
+    return kNoDistance;
+  return it->second;
+}
+
+bool DistanceMap::canReach(INT32 line) const {
+  // without a bitset or debug information, nothing can be ruled out
+  if (reach_ == NULL || line <= 0)
+    return true;
+  return hunt::huntCanReach(reach_, header_->ReachLines, line);
+}
+
+} // namespace qsym
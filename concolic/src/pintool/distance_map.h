@@ -0,0 +1,57 @@
+#ifndef QSYM_DISTANCE_MAP_H_
+#define QSYM_DISTANCE_MAP_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "common.h"
+#include "DistanceMapFormat.h"
+
+namespace qsym {
+
+const INT32 kNoDistance = -1;
+
+// Index of the Hunt distance table produced by GlobalCFGDistancePass.
+// Pairwise tables are queried against the -target_line error point;
+// target-directed tables already hold the distance to the nearest one
+// (interprocedural ones in 1/hunt::kDistanceScale units; only the order of
+// distances matters to the solver).
+// A binary table (DistanceMapFormat.h) is mmap'ed read-only and searched in
+// place, so every concolic run shares the same page cache. A legacy text
+// table (cfg_distances.txt) is parsed once and only the rows that lead to
+// the target line are kept in a hash map.
+class DistanceMap {
+public:
+  DistanceMap();
+  ~DistanceMap();
+
+  bool load(const std::string& path, INT32 target_line);
+  INT32 getDistance(INT32 line) const;
+  bool canReach(INT32 line) const;
+
+  bool empty() const { return size() == 0; }
+  size_t size() const;
+  bool isMapped() const { return header_ != NULL; }
+  INT32 target_line() const { return target_line_; }
+
+private:
+  INT32 target_line_;
+  std::unordered_map<INT32, INT32> distances_;
+
+  // binary table
+  void* mapped_;
+  size_t mapped_size_;
+  const hunt::DistanceHeader* header_;
+  const uint64_t* keys_;
+  const int32_t* mapped_distances_;
+  const uint64_t* reach_;
+
+  bool loadText(const std::string& path);
+  bool loadBinary(const std::string& path);
+  void unmap();
+  INT32 findMapped(uint64_t key) const;
+};
+
+} // namespace qsym
+
+#endif // QSYM_DISTANCE_MAP_H_
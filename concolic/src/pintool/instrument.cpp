@@ -1488,7 +1488,7 @@ instrumentCmovRegReg(
     JccKind jcc_kind,
     bool inv) {
   // call instrumentJcc to trigger solver
-  instrumentJcc(thread_ctx, ctx, taken, 0, jcc_kind, inv);
+  instrumentJcc(thread_ctx, ctx, taken, jcc_kind, inv, 0, 0);
   if (taken)
     instrumentMovRegReg(thread_ctx, ctx, dst, src);
 }
@@ -1503,7 +1503,7 @@ instrumentCmovRegMem(
     JccKind jcc_kind,
     bool inv) {
   // call instrumentJcc to trigger solver
-  instrumentJcc(thread_ctx, ctx, taken, 0, jcc_kind, inv);
+  instrumentJcc(thread_ctx, ctx, taken, jcc_kind, inv, 0, 0);
   if (taken)
     instrumentMovRegMem(thread_ctx, ctx, dst,
         base, index, addr, size, disp, scale);
@@ -1568,9 +1568,9 @@ instrumentCmpxchgRegReg(ThreadContext* thread_ctx,
 
   // solve
   instrumentJcc(thread_ctx, ctx, true,
-      0,
       JCC_Z,
-      val_ax != val_dst);
+      val_ax != val_dst,
+      0, 0);
 
   if (val_ax == val_dst)
     instrumentMovRegReg(thread_ctx, ctx, dst, src);
@@ -1604,9 +1604,9 @@ instrumentCmpxchgMemReg(ThreadContext* thread_ctx,
 
   // solve
   instrumentJcc(thread_ctx, ctx, true,
-      0,
       JCC_Z,
-      val_ax != val_dst);
+      val_ax != val_dst,
+      0, 0);
 
   if (val_ax == val_dst)
     instrumentMovMemReg(thread_ctx, ctx, base, index, addr, size, disp, scale, src);
@@ -2206,54 +2206,17 @@ instrumentNegNotMem(
 void
 instrumentJcc(ThreadContext* thread_ctx,
     const CONTEXT* ctx,
-    bool taken, ADDRINT target,
-    JccKind jcc_c, bool inv) {
+    bool taken,
+    JccKind jcc_c, bool inv,
+    INT32 taken_line, INT32 not_taken_line) {
   ExprRef e = thread_ctx->computeJcc(ctx, jcc_c, inv);
   if (e) {
     ADDRINT pc = PIN_GetContextReg(ctx, REG_INST_PTR);
-    
-    // add get line number target and not taken block
-    ADDRINT not_taken_block = 0;      
-    IMG img = IMG_FindByAddress(pc);
-    if (IMG_Valid(img)) {
-      INS ins = INS_FindByAddress(pc);
-      if (INS_Valid(ins)) {
-        not_taken_block = pc + INS_Size(ins);
-      } else {
-        LOG_ERROR("Invalid INS for PC=" + hexstr(pc) + "\n");
-      }
-    } else {
-      LOG_ERROR("Invalid IMG for PC=" + hexstr(pc) + "\n");
-    }
-
-    LOG_DEBUG("JCC Branch Info: PC=" + hexstr(pc) +
-              ", Taken Block=" + hexstr(target) +
-              ", Not Taken Block=" + hexstr(not_taken_block) + "\n");
-   
-    const char *file_name;
-    int target_line_number;
-    int target_column_number;
-    if (PIN_GetSourceLocation(target, &file_name, &target_line_number, &column_number)) {
-        std::cout << "target File: " << file_name 
-                  << ",target Line: " << line_number 
-                  << ",target Column: " << column_number << std::endl;
-    }
-
-    const char *not_taken_file_name;
-    int not_taken_line_number;
-    int not_taken_column_number;
-    if (PIN_GetSourceLocation(not_taken_block, &not_taken_file_name, &not_taken_line_number, &not_taken_column_number)) {
-        std::cout << "not taken File: " << not_taken_file_name 
-                  << ",not taken Line: " << not_taken_line_number 
-                  << ",not taken Column: " << not_taken_column_number << std::endl;
-    }
-    
     LOG_DEBUG("Symbolic branch at " + hexstr(pc) + ": " + e->toString() + "\n");
 #ifdef CONFIG_TRACE
     trace_addJcc(e, ctx, taken);
 #endif
-    g_solver->addJcc(e, taken, pc); //这里去添加约束
-    g_solver->addHuntJcc(e, taken, pc,target_line_number,not_taken_line_number); //这里去添加约束
+    g_solver->addHuntJcc(e, taken, pc, taken_line, not_taken_line);
   }
 }
 
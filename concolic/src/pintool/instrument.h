@@ -400,9 +400,10 @@ instrumentJcc(
     ThreadContext* thread_ctx,
     const CONTEXT* ctx,
     bool taken,
-    ADDRINT target,
     JccKind jcc_kind,
-    bool inv);
+    bool inv,
+    INT32 taken_line,
+    INT32 not_taken_line);
 
 void PIN_FAST_ANALYSIS_CALL
 instrumentJmpReg(ThreadContext* thread_ctx, const CONTEXT* ctx, REG);
@@ -43,6 +43,10 @@ static KNOB<string> g_opt_bitmap(KNOB_MODE_WRITEONCE, "pintool",
     "b", "", "bitmap file");
 static KNOB<int> g_opt_linearization(KNOB_MODE_WRITEONCE, "pintool",
     "l", "0", "turn on linearization");
+static KNOB<string> g_opt_distance(KNOB_MODE_WRITEONCE, "pintool",
+    "distance", "", "hunt distance file");
+static KNOB<int> g_opt_target_line(KNOB_MODE_WRITEONCE, "pintool",
+    "target_line", "0", "source line of the target error point");
 
 namespace {
 
@@ -80,8 +84,10 @@ multiple_opt:
 void initializeGlobalContext(
     const std::string input,
     const std::string out_dir,
-    const std::string bitmap) {
-  g_solver = new Solver(input, out_dir, bitmap);
+    const std::string bitmap,
+    const std::string distance_file,
+    INT32 target_line) {
+  g_solver = new Solver(input, out_dir, bitmap, distance_file, target_line);
 
   if (g_opt_linearization.Value())
     g_expr_builder = PruneExprBuilder::create();
@@ -109,7 +115,9 @@ int main(int argc, char** argv) {
   initializeGlobalContext(
       g_opt_input.Value(),
       g_opt_outdir.Value(),
-      g_opt_bitmap.Value());
+      g_opt_bitmap.Value(),
+      g_opt_distance.Value(),
+      g_opt_target_line.Value());
   initializeQsym();
   PIN_StartProgram();
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <set>
 #include <byteswap.h>
 #include "solver.h"
@@ -9,6 +10,7 @@ namespace {
 const uint64_t kUsToS = 1000000;
 const int kSessionIdLength = 32;
 const unsigned kSolverTimeout = 10000; // 10 seconds
+const uint64_t kMsToUs = 1000;
 
 std::string toString6digit(INT32 val) {
   char buf[6 + 1]; // ndigit + 1
@@ -80,10 +82,24 @@ inline bool isEqual(ExprRef e, bool taken) {
 
 } // namespace
 
+static KNOB<bool> g_opt_defer_solving(KNOB_MODE_WRITEONCE, "pintool",
+    "defer_solving", "0",
+    "Queue interesting branches and negate the closest ones first in batches");
+static KNOB<UINT32> g_opt_defer_queue_size(KNOB_MODE_WRITEONCE, "pintool",
+    "defer_queue_size", "64",
+    "Negate the queued branches whenever this many are waiting");
+// The executor kills a timed out run 5 s after asking it to stop, so the
+// drain at exit has to fit in well under that
+static KNOB<UINT64> g_opt_solving_budget(KNOB_MODE_WRITEONCE, "pintool",
+    "solving_budget", "3000",
+    "Solver time in ms for each batch of queued branches (0 = unlimited)");
+
 Solver::Solver(
     const std::string input_file,
     const std::string out_dir,
-    const std::string bitmap)
+    const std::string bitmap,
+    const std::string distance_file,
+    INT32 target_line)
   : input_file_(input_file)
   , inputs_()
   , out_dir_(out_dir)
@@ -97,14 +113,25 @@ Solver::Solver(
   , solving_time_(0)
   , last_pc_(0)
   , dep_forest_()
+  , distance_map_()
+  , branch_trace_()
+  , last_verdict_(BV_NotNegated)
+  , pending_()
+  , num_deferred_(0)
 {
-  // Set timeout for solver
-  z3::params p(context_);
-  p.set(":timeout", kSolverTimeout);
-  solver_.set(p);
+  setTimeout(kSolverTimeout);
 
   checkOutDir();
   readInput();
+  branch_trace_.open(out_dir_);
+  if (!distance_file.empty())
+    loadDistanceMap(distance_file, target_line);
+}
+
+void Solver::setTimeout(unsigned ms) {
+  z3::params p(context_);
+  p.set(":timeout", ms);
+  solver_.set(p);
 }
 
 void Solver::push() {
@@ -187,7 +214,27 @@ void Solver::addJcc(ExprRef e, bool taken, ADDRINT pc) {
   addConstraint(e, taken, is_interesting);
 }
 
-void Solver::addHuntJcc(ExprRef e, bool taken, ADDRINT pc,int  target_line_number,int not_taken_line_number ) {
+void Solver::addHuntJcc(ExprRef e, bool taken, ADDRINT pc,
+    INT32 taken_line, INT32 not_taken_line) {
+  uint64_t solving_time = solving_time_;
+  last_verdict_ = BV_NotNegated;
+
+  // Without a distance table, or without the line that negation would
+  // reach (cmov/cmpxchg, code without debug info), fall back to
+  // coverage-guided negation
+  INT32 negated_line = taken ? not_taken_line : taken_line;
+  if (distance_map_.empty() || pc == 0 || negated_line == 0)
+    addJcc(e, taken, pc);
+  else
+    addDirectedJcc(e, taken, pc, taken_line, not_taken_line);
+
+  if (branch_trace_.enabled())
+    traceBranch(taken, pc, taken_line, not_taken_line,
+        solving_time_ - solving_time);
+}
+
+void Solver::addDirectedJcc(ExprRef e, bool taken, ADDRINT pc,
+    INT32 taken_line, INT32 not_taken_line) {
   // Save the last instruction pointer for debugging
   last_pc_ = pc;
 
@@ -202,17 +249,35 @@ void Solver::addHuntJcc(ExprRef e, bool taken, ADDRINT pc,int  target_line_numbe
 
   assert(isRelational(e.get()));
 
-  bool is_farAway;
-  if (pc != 0) {
-     is_farAway = isInterestingHuntJcc(e, taken, pc,target_line_number,not_taken_line_number);
+  bool is_interesting = isInterestingHuntJcc(e, taken, pc,
+      taken_line, not_taken_line);
+  if (is_interesting) {
+    if (g_opt_defer_solving.Value())
+      deferNegation(e, taken, distance_map_.getDistance(
+            taken ? not_taken_line : taken_line));
+    else
+      negatePath(e, taken);
   }
-
-
-  if (is_farAway)
-    negatePath(e, taken);
   addConstraint(e, taken, is_interesting);
 }
 
+void Solver::traceBranch(bool taken, ADDRINT pc,
+    INT32 taken_line, INT32 not_taken_line, uint64_t solving_time) {
+  BranchRecord record;
+  record.pc = pc;
+  record.taken_line = taken_line;
+  record.not_taken_line = not_taken_line;
+  record.followed_distance = distance_map_.getDistance(
+      taken ? taken_line : not_taken_line);
+  record.negated_distance = distance_map_.getDistance(
+      taken ? not_taken_line : taken_line);
+  record.solving_time = solving_time;
+  record.taken = taken;
+  record.verdict = last_verdict_;
+  record.reserved = 0;
+  branch_trace_.add(record);
+}
+
 void Solver::addAddr(ExprRef e, ADDRINT addr) {
   llvm::APInt v(e->bits(), addr);
   addAddr(e, v);
@@ -319,6 +384,17 @@ void Solver::readInput() {
     inputs_.push_back((UINT8)ch);
 }
 
+void Solver::loadDistanceMap(const std::string& path, INT32 target_line) {
+  uint64_t before = getTimeStamp();
+  if (!distance_map_.load(path, target_line))
+    return;
+  uint64_t elapsed = getTimeStamp() - before;
+  LOG_STAT(
+      "DISTANCE: { \"load_time\": " + decstr(elapsed) + ", "
+      + "\"entries\": " + decstr((UINT64)distance_map_.size()) + ", "
+      + "\"mapped\": " + decstr((INT32)distance_map_.isMapped()) + " }\n");
+}
+
 std::vector<UINT8> Solver::getConcreteValues() {
   // TODO: change from real input
   z3::model m = solver_.get_model();
@@ -416,6 +492,17 @@ void Solver::addToSolver(ExprRef e, bool taken) {
 }
 
 void Solver::syncConstraints(ExprRef e) {
+  std::vector<ExprRef> constraints;
+  collectConstraints(e, constraints);
+  for (ExprRef& constraint : constraints)
+    addToSolver(constraint, true);
+
+  checkFeasible();
+}
+
+// The path constraints that e depends on, as syncConstraints() adds them
+void Solver::collectConstraints(ExprRef e,
+    std::vector<ExprRef>& constraints) {
   std::set<std::shared_ptr<DependencyTree<Expr>>> forest;
   DependencySet* deps = e->getDependencies();
 
@@ -426,14 +513,14 @@ void Solver::syncConstraints(ExprRef e) {
     std::vector<std::shared_ptr<Expr>> nodes = tree->getNodes();
     for (std::shared_ptr<Expr> node : nodes) {
       if (isRelational(node.get()))
-        addToSolver(node, true);
+        constraints.push_back(node);
       else {
         // Process range-based constraints
         bool valid = false;
         for (INT32 i = 0; i < 2; i++) {
           ExprRef expr_range = getRangeConstraint(node, i);
           if (expr_range != NULL) {
-            addToSolver(expr_range, true);
+            constraints.push_back(expr_range);
             valid = true;
           }
         }
@@ -444,8 +531,6 @@ void Solver::syncConstraints(ExprRef e) {
       }
     }
   }
-
-  checkFeasible();
 }
 
 void Solver::addConstraint(ExprRef e, bool taken, bool is_interesting) {
@@ -534,46 +619,31 @@ ExprRef Solver::getRangeConstraint(ExprRef e, bool is_unsigned) {
 }
 
 
-bool Solver::isInterestingHuntJcc(ExprRef rel_expr, bool taken, ADDRINT pc,int target_line_number,int not_taken_line_number) {
-  bool interesting = false;
-
-    std::ifstream dist_file(distance_file_path_);
-    if (!dist_file.is_open()) {
-        std::cerr << "Error opening distance file: " << distance_file_path_ << std::endl;
-        return false;
-    }
+bool Solver::isInterestingHuntJcc(ExprRef rel_expr, bool taken, ADDRINT pc,
+    INT32 taken_line, INT32 not_taken_line) {
+  // Negating towards a line that cannot reach any target is wasted work
+  if (!distance_map_.canReach(taken ? not_taken_line : taken_line)) {
+    LOG_DEBUG("Hunt branch at " + hexstr(pc) + ": dead end\n");
+    last_interested_ = false;
+    return false;
+  }
 
-    std::string line;
-    int target_distance = -1;
-    int not_taken_distance = -1;
-
-    while (std::getline(dist_file, line)) {
-        std::istringstream iss(line);
-        int line1, line2, distance;
-
-        if (iss >> line1 >> line2 >> distance) {
-            // 检查 target_line_number 和 not_taken_line_number 是否匹配
-            if ((line1 == target_line_number && line2 == target_line_number) || 
-                (line2 == target_line_number && line1 == target_line_number)) {
-                target_distance = distance;
-            }
-            if ((line1 == not_taken_line_number && line2 == not_taken_line_number) || 
-                (line2 == not_taken_line_number && line1 == not_taken_line_number)) {
-                not_taken_distance = distance;
-            }
-        }
-    }
+  INT32 followed = distance_map_.getDistance(
+      taken ? taken_line : not_taken_line);
+  INT32 negated = distance_map_.getDistance(
+      taken ? not_taken_line : taken_line);
 
-    if (target_distance == -1 || not_taken_distance == -1) {
-        std::cerr << "Error: Unable to find distances for given line numbers." << std::endl;
-        return false;
-    }
+  // Negate only if the other side gets closer to the target
+  bool interesting = negated != kNoDistance
+    && (followed == kNoDistance || negated < followed);
 
-    if (std::abs(target_distance - targetInstLine_) > std::abs(not_taken_distance - targetInstLine_)) {
-        interesting = true;
-    }
+  LOG_DEBUG("Hunt branch at " + hexstr(pc)
+      + ": followed=" + decstr(followed)
+      + ", negated=" + decstr(negated) + "\n");
 
-    return interesting;
+  // record for other decision
+  last_interested_ = interesting;
+  return interesting;
 }
 
 bool Solver::isInterestingJcc(ExprRef rel_expr, bool taken, ADDRINT pc) {
@@ -584,18 +654,77 @@ bool Solver::isInterestingJcc(ExprRef rel_expr, bool taken, ADDRINT pc) {
 }
 
 void Solver::negatePath(ExprRef e, bool taken) {
+  std::vector<ExprRef> constraints;
+  collectConstraints(e, constraints);
+  solveNegation(constraints, e, taken);
+}
+
+void Solver::solveNegation(const std::vector<ExprRef>& constraints,
+    ExprRef e, bool taken) {
   reset();
-  syncConstraints(e);
+  for (const ExprRef& constraint : constraints)
+    addToSolver(constraint, true);
+  checkFeasible();
   addToSolver(e, !taken);
   bool sat = checkAndSave();
+  last_verdict_ = BV_Sat;
   if (!sat) {
     reset();
     // optimistic solving
     addToSolver(e, !taken);
-    checkAndSave("optimistic");
+    last_verdict_ = checkAndSave("optimistic") ? BV_Optimistic : BV_Unsat;
   }
 }
 
+void Solver::deferNegation(ExprRef e, bool taken, INT32 distance) {
+  // The path constraints keep growing after this branch, so take the ones
+  // that hold here now
+  PendingNegation pending;
+  pending.distance = distance;
+  pending.seq = num_deferred_++;
+  pending.expr = e;
+  pending.taken = taken;
+  collectConstraints(e, pending.constraints);
+  pending_.push(pending);
+  last_verdict_ = BV_Deferred;
+
+  // a run cut off by a timeout only keeps what was solved before it
+  if (pending_.size() >= g_opt_defer_queue_size.Value())
+    solvePendingNegations();
+}
+
+void Solver::solvePendingNegations() {
+  uint64_t budget = g_opt_solving_budget.Value() * kMsToUs;
+  uint64_t start = solving_time_;
+  size_t total = pending_.size();
+
+  while (!pending_.empty()) {
+    uint64_t spent = solving_time_ - start;
+    if (budget != 0 && spent >= budget) {
+      LOG_INFO("Solving budget is exhausted: " + decstr(pending_.size())
+          + " of " + decstr(total) + " branches are not negated\n");
+      break;
+    }
+    // a negation checks at most twice (optimistic solving), so neither
+    // check may take more than half of what is left
+    if (budget != 0)
+      setTimeout(std::min<uint64_t>(kSolverTimeout,
+            std::max<uint64_t>(1, (budget - spent) / kMsToUs / 2)));
+    const PendingNegation& pending = pending_.top();
+    LOG_DEBUG("Negate a deferred branch at distance "
+        + decstr(pending.distance) + "\n");
+    solveNegation(pending.constraints, pending.expr, pending.taken);
+    pending_.pop();
+  }
+  if (budget != 0)
+    setTimeout(kSolverTimeout);
+
+  // the rest are farther than any branch negated here; dropping them
+  // keeps the queue within -defer_queue_size
+  while (!pending_.empty())
+    pending_.pop();
+}
+
 void Solver::solveOne(z3::expr z3_expr) {
   push();
   add(z3_expr);
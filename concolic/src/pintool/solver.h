@@ -3,6 +3,7 @@
 
 #include <z3++.h>
 #include <fstream>
+#include <queue>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -10,15 +11,36 @@
 #include "pin.H"
 
 #include "afl_trace_map.h"
+#include "branch_trace.h"
 #include "expr.h"
 #include "thread_context.h"
 #include "dependency.h"
+#include "distance_map.h"
 
 namespace qsym {
 
 extern z3::context g_z3_context;
 typedef std::unordered_set<ExprRef, ExprRefHash, ExprRefEqual> ExprRefSetTy;
 
+// A branch to negate later: the path constraints it depended on when it
+// was reached, and the distance of the side that negation would take.
+struct PendingNegation {
+  INT32 distance;
+  UINT64 seq;
+  ExprRef expr;
+  bool taken;
+  std::vector<ExprRef> constraints;
+};
+
+// Closest to the target first, then in encounter order
+struct PendingNegationOrder {
+  bool operator()(const PendingNegation& a, const PendingNegation& b) const {
+    if (a.distance != b.distance)
+      return a.distance > b.distance;
+    return a.seq > b.seq;
+  }
+};
+
 class Solver {
 public:
   ExprRefSetTy updated_exprs_;
@@ -27,7 +49,9 @@ public:
   Solver(
       const std::string input_file,
       const std::string out_dir,
-      const std::string bitmap);
+      const std::string bitmap,
+      const std::string distance_file="",
+      INT32 target_line=0);
 
   void push();
   void reset();
@@ -37,7 +61,7 @@ public:
 
   bool checkAndSave(const std::string& postfix="");
   void addJcc(ExprRef, bool, ADDRINT);
-  void addHuntJcc(ExprRef, bool, int,int);
+  void addHuntJcc(ExprRef, bool, ADDRINT, INT32, INT32);
   void addAddr(ExprRef, ADDRINT);
   void addAddr(ExprRef, llvm::APInt);
   void addValue(ExprRef, ADDRINT);
@@ -46,6 +70,8 @@ public:
   UINT8 getInput(ADDRINT index);
 
   ADDRINT last_pc() { return last_pc_; }
+  void flushBranchTrace() { branch_trace_.flush(); }
+  void solvePendingNegations();
 
 protected:
   std::string           input_file_;
@@ -62,11 +88,17 @@ protected:
   uint64_t              solving_time_;
   ADDRINT               last_pc_;
   DependencyForest<Expr> dep_forest_;
-  std::string           distance_file_path_; // for distance calculation
-  int                   targetInstLine_; // for distance calculation
-
+  DistanceMap           distance_map_;
+  BranchTrace           branch_trace_;
+  BranchVerdict         last_verdict_;
+  std::priority_queue<PendingNegation, std::vector<PendingNegation>,
+    PendingNegationOrder> pending_;
+  UINT64                num_deferred_;
+
+  void setTimeout(unsigned ms);
   void checkOutDir();
   void readInput();
+  void loadDistanceMap(const std::string& path, INT32 target_line);
 
   std::vector<UINT8> getConcreteValues();
   void saveValues(const std::string& postfix);
@@ -78,6 +110,7 @@ protected:
 
   void addToSolver(ExprRef e, bool taken);
   void syncConstraints(ExprRef e);
+  void collectConstraints(ExprRef e, std::vector<ExprRef>& constraints);
 
   void addConstraint(ExprRef e, bool taken, bool is_interesting);
   void addConstraint(ExprRef e);
@@ -87,8 +120,12 @@ protected:
   ExprRef getRangeConstraint(ExprRef e, bool is_unsigned);
 
   bool isInterestingJcc(ExprRef, bool, ADDRINT);
-  bool isInterestingHuntJcc(ExprRef, bool, int,int);
+  bool isInterestingHuntJcc(ExprRef, bool, ADDRINT, INT32, INT32);
+  void addDirectedJcc(ExprRef, bool, ADDRINT, INT32, INT32);
+  void traceBranch(bool, ADDRINT, INT32, INT32, uint64_t);
   void negatePath(ExprRef, bool);
+  void deferNegation(ExprRef, bool, INT32);
+  void solveNegation(const std::vector<ExprRef>&, ExprRef, bool);
   void solveOne(z3::expr);
 
   void checkFeasible();
@@ -83,6 +83,8 @@ freeThreadContext(THREADID tid, const CONTEXT* ctx, INT32 code, VOID* v) {
   ThreadContext* thread_ctx =
     reinterpret_cast<ThreadContext*>(PIN_GetContextReg(ctx, g_thread_context_reg));
   delete thread_ctx;
+  g_solver->solvePendingNegations();
+  g_solver->flushBranchTrace();
 }
 
 static inline void
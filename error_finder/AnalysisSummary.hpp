@@ -0,0 +1,70 @@
+#ifndef ANALYZER_ANALYSISSUMMARY_HPP
+#define ANALYZER_ANALYSISSUMMARY_HPP
+
+#include "FaultSiteSummary.hpp"
+#include "NullableMemberSummary.hpp"
+
+#include <filesystem>
+#include <optional>
+
+// The summaries of one module that the ErrorFinder pass plugin writes and
+// ErrorFinderMerge combines. An analysis that was not run has none.
+struct AnalysisSummary {
+    static constexpr char const* EXTENSION = ".errfind.json";
+    // bump whenever a summary or the way it is computed changes
+    static constexpr int VERSION = 1;
+
+    bool kernelMode = false;  // the fault site summary depends on it
+    bool taintChecks = false;  // and on this
+    std::optional<ModuleSummary> faultSite;
+    std::optional<NullableModuleSummary> nullableMember;
+
+    void fill_ptree(ptree& pt) {
+        pt.put("version", VERSION);
+        pt.put("kernelMode", kernelMode);
+        pt.put("taintChecks", taintChecks);
+        if (faultSite) {
+            ptree child;
+            faultSite->fill_ptree(child);
+            pt.add_child("faultSite", child);
+        }
+        if (nullableMember) {
+            ptree child;
+            nullableMember->fill_ptree(child);
+            pt.add_child("nullableMember", child);
+        }
+    }
+
+    void extract_ptree(ptree& pt) {
+        if (pt.get<int>("version") != VERSION)
+            throw std::runtime_error("summary from an incompatible version");
+        kernelMode = pt.get<bool>("kernelMode");
+        taintChecks = pt.get<bool>("taintChecks", false);
+        if (auto child = pt.get_child_optional("faultSite"))
+            faultSite.emplace().extract_ptree(*child);
+        if (auto child = pt.get_child_optional("nullableMember"))
+            nullableMember.emplace().extract_ptree(*child);
+    }
+
+    bool write(const std::filesystem::path& path) {
+        ptree pt;
+        fill_ptree(pt);
+        return writeJsonFileAtomically(path, pt);
+    }
+
+    static std::optional<AnalysisSummary> read(const std::filesystem::path& path) {
+        std::ifstream infile(path);
+        AnalysisSummary summary;
+        try {
+            ptree pt;
+            read_json(infile, pt);
+            summary.extract_ptree(pt);
+        } catch (const std::exception& e) {
+            llvm::errs() << "Error reading summary " << path.string() << ": " << e.what() << "\n";
+            return std::nullopt;
+        }
+        return summary;
+    }
+};
+
+#endif
@@ -5,6 +5,7 @@
 
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/Support/ThreadPool.h>
 #include <boost/program_options.hpp>
 #include <iomanip>
 
@@ -17,8 +18,13 @@ int main(int argc, char** argv) {
 
     std::string dir;
     bool kernelMode;
+    bool taintChecks;
     std::string srcPath;
     std::string outputPath;
+    unsigned jobs;
+    bool lazy;
+    std::string cacheDir;
+    bool binaryOutput;
     bpo::options_description opts("Analyze Fault Points. ErrorFinder [options]",
                                   getTerminalWidth());
     bpo::variables_map vm;
@@ -37,6 +43,11 @@ int main(int argc, char** argv) {
     ("kernelMode",
         bpo::value<bool>(&kernelMode)->default_value(false),
         "Anaylyze deeply if in kernel")
+    ("taintChecks",
+        bpo::value<bool>(&taintChecks)->default_value(false),
+        "Count a return value as checked only if a compare of it against "
+        "0/NULL or a switch on it is reachable by taint dataflow, instead of "
+        "any compare of its aliases")
     ("faultSite", 
         bpo::value<bool>(&analyzeFaultSite)->default_value(false),
         "analyze fault site")
@@ -45,7 +56,23 @@ int main(int argc, char** argv) {
         "analyze nullable member")
     ("srcPath", 
         bpo::value<std::string>(&srcPath)->default_value(""),
-        "The parent of src dir? Using for manually anaylyzing fault points");
+        "The parent of src dir? Using for manually anaylyzing fault points")
+    ("jobs,j",
+        bpo::value<unsigned>(&jobs)->default_value(1),
+        "Number of threads parsing IR files, summarizing functions and "
+        "analyzing modules for nullable members (0 = all cores)")
+    ("lazy",
+        bpo::value<bool>(&lazy)->default_value(false),
+        "Stream IR files through each phase with lazy loading instead of "
+        "keeping all modules in memory")
+    ("cache",
+        bpo::value<std::string>(&cacheDir)->default_value(""),
+        "Directory caching per-module fault site summaries across runs; "
+        "with --lazy 1 unchanged modules are not even loaded")
+    ("binary",
+        bpo::value<bool>(&binaryOutput)->default_value(false),
+        "Also write the results in the compact binary format "
+        "(<output>.faultsite.bin, <output>.nullable.bin)");
 
     try {
         bpo::store(bpo::command_line_parser(argc, argv).options(opts).run(),
@@ -86,122 +113,110 @@ int main(int argc, char** argv) {
     AliasRecursiveAnalysis aliasRecursiveAnalysis;
     aliasRecursiveAnalysis.deepMode = kernelMode;
     aliasRecursiveAnalysis.kernelMode = kernelMode;
+    aliasRecursiveAnalysis.taintChecks = taintChecks;
+    aliasRecursiveAnalysis.jobs = jobs;
+
+    std::unique_ptr<FaultSiteSummaryCache> summaryCache;
+    if (!cacheDir.empty()) {
+        summaryCache = std::make_unique<FaultSiteSummaryCache>(cacheDir, kernelMode, taintChecks);
+        aliasRecursiveAnalysis.summaryCache = summaryCache.get();
+    }
 
     NullableMemberAnalysis nullableMemberAnalysis;
+    nullableMemberAnalysis.jobs = jobs;
 
     // Makes sure llvm_shutdown() is called (which cleans up LLVM objects)
     //  http://llvm.org/docs/ProgrammersManual.html#ending-execution-with-llvm-shutdown
     llvm::llvm_shutdown_obj SDO;
 
-    std::unordered_map<std::string, std::unique_ptr<llvm::Module>>
-        filenameModuleMap;
+    // what the analyses look at in each module, found in one walk
+    std::unordered_map<std::string, mfuzz::ModuleIndex> filenameIndexMap;
 
     time_t startTime;
 
     uint64_t totalCallSite = 0;
 
-    llvm::LLVMContext Ctx;
+    // Every module gets its own context so that modules can be parsed
+    // concurrently. This also keeps struct names as they are in each file
+    // instead of the ".N" suffixes a shared context adds on clashes.
+    // Modules stay here next to their contexts, which must outlive them,
+    // hence declared first.
+    struct ParsedModule {
+        std::unique_ptr<llvm::LLVMContext> ctx;
+        std::unique_ptr<llvm::Module> module;
+        std::string error;
+        mfuzz::ModuleIndex index;
+    };
+    // The streaming mode reloads the modules per phase inside the analyses,
+    // so nothing is parsed up front.
+    std::vector<ParsedModule> parsedModules(lazy ? 0 : fileNames.size());
+
+    auto parseModule = [&](size_t index) {
+        ParsedModule& parsed = parsedModules[index];
+        llvm::SMDiagnostic Err;
+
+        parsed.ctx = std::make_unique<llvm::LLVMContext>();
+        parsed.module = llvm::parseIRFile(fileNames[index], Err, *parsed.ctx);
+        if (!parsed.module) {
+            parsed.error = Err.getMessage().str();
+            return;
+        }
+
+        parsed.index = mfuzz::ModuleIndex(*parsed.module);
+    };
 
     // prepare all modules
-    for (std::string& fileName : fileNames) {
-        llvm::SMDiagnostic Err;
+    if (jobs == 1) {
+        for (size_t i = 0; i < parsedModules.size(); i++)
+            parseModule(i);
+    } else if (!parsedModules.empty()) {
+        llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+        for (size_t i = 0; i < parsedModules.size(); i++)
+            pool.async(parseModule, i);
+        pool.wait();
+    }
 
-        std::unique_ptr<llvm::Module> modulePtr =
-            llvm::parseIRFile(fileName, Err, Ctx);
+    // merge in file order, so the analyses see the same map as a serial run
+    for (size_t i = 0; i < parsedModules.size(); i++) {
+        const std::string& fileName = fileNames[i];
+        ParsedModule& parsed = parsedModules[i];
 
         llvm::errs() << "Parsing " << fileName << "\n";
-        if (!modulePtr) {
+        if (!parsed.module) {
             llvm::errs() << "Error reading bitcode file: " << fileName << ": "
-                         << Err.getMessage() << "\n";
+                         << parsed.error << "\n";
             continue;
         }
 
-        llvm::Module& M = *modulePtr;
-        for (auto& F : M) {
-            if (F.isDeclaration()) {
-                continue;
-            }
-
-            for (auto& ins : instructions(F)) {
-                if (llvm::isa<llvm::CallInst>(&ins)) {
-                    totalCallSite++;
-                }
-            }
-        }
-        filenameModuleMap.insert({fileName, std::move(modulePtr)});
+        totalCallSite += parsed.index.callInstCount;
+        filenameIndexMap.insert({fileName, std::move(parsed.index)});
     }
 
-    std::cout << "total call site: " << totalCallSite << "\n";
+    if (!lazy)
+        std::cout << "total call site: " << totalCallSite << "\n";
 
     if (analyzeFaultSite) {
-        aliasRecursiveAnalysis.analyze(filenameModuleMap);
+        if (lazy)
+            aliasRecursiveAnalysis.analyzeLazily(fileNames);
+        else
+            aliasRecursiveAnalysis.analyze(filenameIndexMap);
+        if (summaryCache) {
+            llvm::errs() << "summary cache: " << summaryCache->hits << " hits, "
+                         << summaryCache->misses << " misses\n";
+        }
 
         // output information
-        std::ofstream outfile(outputPath + ".faultsite");
-
-        std::sort(aliasRecursiveAnalysis.faultSiteInfoVec.begin(),
-                  aliasRecursiveAnalysis.faultSiteInfoVec.end(),
-                  [](const FaultPointInfo& info1, const FaultPointInfo& info2) {
-                      return (info1.calleeName < info2.calleeName) ||
-                             (info1.calleeName == info2.calleeName &&
-                              info1.functionName < info2.functionName) ||
-                             (info1.calleeName == info2.calleeName &&
-                              info1.functionName == info2.functionName &&
-                              info1.serialNumber < info2.serialNumber);
-                  });
-
-        std::vector<FaultPointInfo> finalVec;
-            
-        for (FaultPointInfo& info : aliasRecursiveAnalysis.faultSiteInfoVec) {
-            auto& [total, checked, direct] = aliasRecursiveAnalysis
-                                .funcExternalCheckedTimes[info.calleeName];
-
-            if (!checked) {  // never checked, not necessary though
-                continue;
-            }
-            info.faultSiteNum = total;
-            info.checkedNum = checked;
-            info.directNum = direct;
-
-            finalVec.push_back(info);
-        }
-        
-        InstructionLocationInfo::output_vector(outfile, finalVec);
+        aliasRecursiveAnalysis.writeResults(outputPath, binaryOutput);
     }
 
     if (analyzeNullableMember) {
-        nullableMemberAnalysis.analyze(filenameModuleMap);
-
-        std::ofstream outfile(outputPath + ".nullable");
-
-        std::sort(nullableMemberAnalysis.nullableMemberVector.begin(),
-                  nullableMemberAnalysis.nullableMemberVector.end(),
-                  [](const NullableMemberInfo& info1,
-                     const NullableMemberInfo& info2) {
-                      if (info1.parentTypeName == info2.parentTypeName) {
-                          if (info1.offset == info2.offset) {
-                              if (info1.functionName == info2.functionName) {
-                                  return info1.serialNumber <
-                                         info2.serialNumber;
-                              }
-                              return info1.functionName < info2.functionName;
-                          }
-                          return info1.offset < info2.offset;
-                      }
-                      return info1.parentTypeName < info2.parentTypeName;
-                  });
-
-        InstructionLocationInfo::output_vector(outfile,
-                                               nullableMemberAnalysis
-                                                   .nullableMemberVector);
-    }
+        if (lazy)
+            nullableMemberAnalysis.analyzeLazily(fileNames);
+        else
+            nullableMemberAnalysis.analyze(filenameIndexMap);
 
-    for (const auto& fileModulePair : filenameModuleMap) {
-        const std::string& fileName = fileModulePair.first;
-        std::unique_ptr<llvm::Module> modulePtr = std::move(filenameModuleMap[fileName]);
-        llvm::Module& M = *modulePtr;
+        nullableMemberAnalysis.writeResults(outputPath, binaryOutput);
     }
 
-
     return 0;
 }
\ No newline at end of file
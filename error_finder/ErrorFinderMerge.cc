@@ -0,0 +1,155 @@
+#include "AnalyzerUtils.hpp"
+#include "TaintAnalysis.hpp"
+#include "commonconfig.h"
+#include "commonutils.hpp"
+
+#include <boost/program_options.hpp>
+
+#include "FaultSiteAnalysis.hpp"
+#include "NullableMemberAnalysis.hpp"
+#include "AnalysisSummary.hpp"
+
+// The summaries the ErrorFinder pass plugin wrote under dirName, sorted
+// like the IR files of an ErrorFinder run
+std::vector<std::string> getAllSummaryNamesInDir(const std::string& dirName) {
+    std::vector<std::string> fileNames;
+    if (!std::filesystem::is_directory(dirName)) return fileNames;
+    for (auto& p : std::filesystem::recursive_directory_iterator(dirName)) {
+        std::string fileName = p.path();
+        if (p.is_regular_file() && llvm::StringRef(fileName).endswith(AnalysisSummary::EXTENSION)) {
+            fileNames.push_back(fileName);
+        }
+    }
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+int main(int argc, char** argv) {
+    using namespace mfuzz;
+    namespace bpo = boost::program_options;
+
+    std::string dir;
+    bool kernelMode;
+    bool taintChecks;
+    std::string srcPath;
+    std::string outputPath;
+    bool binaryOutput;
+    bpo::options_description opts("Merge the module summaries of the ErrorFinder pass plugin. "
+                                  "ErrorFinderMerge [options]",
+                                  getTerminalWidth());
+    bpo::variables_map vm;
+
+    bool analyzeFaultSite;
+    bool analyzeNullableMember;
+
+    opts.add_options()
+    ("help,h", "Print this")
+    ("input-dir,i",
+        bpo::value<std::string>(&dir)->default_value("."),
+        "The directory searched recursively for *.errfind.json summaries")
+    ("output,o",
+        bpo::value<std::string>(&outputPath)->default_value(TMP_ANALYSIS_RESULT_PATH),
+       "The output path of analysis result")
+    ("kernelMode",
+        bpo::value<bool>(&kernelMode)->default_value(false),
+        "Anaylyze deeply if in kernel; must match -error-finder-kernel-mode of the plugin")
+    ("taintChecks",
+        bpo::value<bool>(&taintChecks)->default_value(false),
+        "Checks found by taint dataflow; must match -error-finder-taint-checks of the plugin")
+    ("faultSite",
+        bpo::value<bool>(&analyzeFaultSite)->default_value(false),
+        "analyze fault site")
+    ("nullableMember",
+        bpo::value<bool>(&analyzeNullableMember)->default_value(false),
+        "analyze nullable member")
+    ("srcPath",
+        bpo::value<std::string>(&srcPath)->default_value(""),
+        "The parent of src dir? Using for manually anaylyzing fault points")
+    ("binary",
+        bpo::value<bool>(&binaryOutput)->default_value(false),
+        "Also write the results in the compact binary format "
+        "(<output>.faultsite.bin, <output>.nullable.bin)");
+
+    try {
+        bpo::store(bpo::command_line_parser(argc, argv).options(opts).run(),
+                   vm);
+        bpo::notify(vm);
+    } catch (...) {
+        std::cerr << "Error parsing command line arguments" << std::endl;
+        std::cout << opts << "\n";
+        return 1;
+    }
+    if (vm.count("help")) {
+        std::cout << opts << "\n";
+        return 0;
+    }
+
+    if (!analyzeFaultSite && !analyzeNullableMember) {
+        std::cerr << "Please specify at least one analysis" << std::endl;
+        std::cout << opts << "\n";
+        return 1;
+    }
+
+    std::vector<std::string> fileNames = getAllSummaryNamesInDir(dir);
+    if (fileNames.empty()) {
+        std::cerr << "No summaries in " << dir << std::endl;
+        return 1;
+    }
+
+    llvm::dbgs() << "kernel mode: " << (kernelMode ? "true" : "false") << "\n";
+
+    if (!srcPath.empty()) {
+        InstructionLocationInfo::outputSourceCode = true;
+        InstructionLocationInfo::modulePath = srcPath;
+        llvm::dbgs() << "module path: " << srcPath << "\n";
+    }
+
+    llvm::dbgs() << "\n";
+
+    std::vector<ModuleSummary> faultSiteSummaries;
+    std::vector<NullableModuleSummary> nullableMemberSummaries;
+    for (const std::string& fileName : fileNames) {
+        llvm::errs() << "Reading " << fileName << "\n";
+        std::optional<AnalysisSummary> summary = AnalysisSummary::read(fileName);
+        if (!summary)
+            continue;
+        if (summary->kernelMode != kernelMode) {
+            llvm::errs() << "Error: " << fileName << " was summarized with kernel mode "
+                         << (summary->kernelMode ? "on" : "off") << "\n";
+            continue;
+        }
+        if (summary->taintChecks != taintChecks) {
+            llvm::errs() << "Error: " << fileName << " was summarized with taint checks "
+                         << (summary->taintChecks ? "on" : "off") << "\n";
+            continue;
+        }
+        if (analyzeFaultSite) {
+            if (summary->faultSite)
+                faultSiteSummaries.push_back(std::move(*summary->faultSite));
+            else
+                llvm::errs() << "Error: " << fileName << " has no fault site summary\n";
+        }
+        if (analyzeNullableMember) {
+            if (summary->nullableMember)
+                nullableMemberSummaries.push_back(std::move(*summary->nullableMember));
+            else
+                llvm::errs() << "Error: " << fileName << " has no nullable member summary\n";
+        }
+    }
+
+    if (analyzeFaultSite) {
+        AliasRecursiveAnalysis aliasRecursiveAnalysis;
+        aliasRecursiveAnalysis.deepMode = kernelMode;
+        aliasRecursiveAnalysis.kernelMode = kernelMode;
+        aliasRecursiveAnalysis.mergeSummaries(faultSiteSummaries);
+        aliasRecursiveAnalysis.writeResults(outputPath, binaryOutput);
+    }
+
+    if (analyzeNullableMember) {
+        NullableMemberAnalysis nullableMemberAnalysis;
+        nullableMemberAnalysis.mergeSummaries(nullableMemberSummaries);
+        nullableMemberAnalysis.writeResults(outputPath, binaryOutput);
+    }
+
+    return 0;
+}
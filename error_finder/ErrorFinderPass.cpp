@@ -0,0 +1,118 @@
+// The ErrorFinder analyses as a new pass manager plugin. Each module the
+// compiler (or the LTO link) builds gets its fault site and nullable member
+// summaries written to <module>.errfind.json, and ErrorFinderMerge turns
+// the summaries of all modules into the usual results, so the IR does not
+// have to be dumped and parsed again.
+//
+//   opt -load-pass-plugin=libErrorFinderPass.so -passes=error-finder-summary
+//   clang -fpass-plugin=libErrorFinderPass.so
+//   ld.lld --load-pass-plugin=libErrorFinderPass.so (LTO)
+//
+// With clang and lld the pass runs last in the optimization pipeline. Its
+// -error-finder-* options are only registered once the library is loaded
+// before the command line is parsed: pass -load libErrorFinderPass.so to
+// opt, and -Xclang -load -Xclang libErrorFinderPass.so to clang.
+
+#include "AnalyzerUtils.hpp"
+#include "TaintAnalysis.hpp"
+#include "commonutils.hpp"
+
+#include "FaultSiteAnalysis.hpp"
+#include "NullableMemberAnalysis.hpp"
+#include "AnalysisSummary.hpp"
+
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+
+namespace {
+
+llvm::cl::opt<std::string> summaryDir(
+    "error-finder-summary-dir",
+    llvm::cl::desc("Directory for the module summaries (default: next to "
+                   "the module, named after its identifier)"),
+    llvm::cl::value_desc("dir"));
+
+llvm::cl::opt<bool> summaryKernelMode(
+    "error-finder-kernel-mode",
+    llvm::cl::desc("Summarize fault sites as ErrorFinder --kernelMode 1 does"));
+
+llvm::cl::opt<bool> summaryTaintChecks(
+    "error-finder-taint-checks",
+    llvm::cl::desc("Summarize checks as ErrorFinder --taintChecks 1 does"));
+
+llvm::cl::opt<bool> summaryFaultSite(
+    "error-finder-fault-site",
+    llvm::cl::desc("Summarize fault sites"), llvm::cl::init(true));
+
+llvm::cl::opt<bool> summaryNullableMember(
+    "error-finder-nullable-member",
+    llvm::cl::desc("Summarize nullable members"), llvm::cl::init(true));
+
+std::filesystem::path getSummaryPath(llvm::Module& M) {
+    std::string name = M.getModuleIdentifier() + AnalysisSummary::EXTENSION;
+    if (summaryDir.empty())
+        return name;
+    // modules from different directories may share a file name
+    std::replace(name.begin(), name.end(), '/', '_');
+    return std::filesystem::path(summaryDir.getValue()) / name;
+}
+
+struct ErrorFinderSummaryPass : llvm::PassInfoMixin<ErrorFinderSummaryPass> {
+    llvm::PreservedAnalyses run(llvm::Module& M, llvm::ModuleAnalysisManager&) {
+        mfuzz::ModuleIndex index(M);
+
+        AnalysisSummary summary;
+        summary.kernelMode = summaryKernelMode;
+        summary.taintChecks = summaryTaintChecks;
+        if (summaryFaultSite) {
+            AliasRecursiveAnalysis aliasRecursiveAnalysis;
+            aliasRecursiveAnalysis.deepMode = summaryKernelMode;
+            aliasRecursiveAnalysis.kernelMode = summaryKernelMode;
+            aliasRecursiveAnalysis.taintChecks = summaryTaintChecks;
+            summary.faultSite = aliasRecursiveAnalysis.summarizeModule(index);
+        }
+        if (summaryNullableMember) {
+            NullableMemberAnalysis nullableMemberAnalysis;
+            summary.nullableMember = nullableMemberAnalysis.summarizeModule(index);
+        }
+
+        std::filesystem::path path = getSummaryPath(M);
+        if (!summaryDir.empty()) {
+            std::error_code ec;
+            std::filesystem::create_directories(summaryDir.getValue(), ec);
+        }
+        if (!summary.write(path))
+            llvm::errs() << "WARNING: cannot write ErrorFinder summary " << path.string() << "\n";
+        return llvm::PreservedAnalyses::all();
+    }
+
+    // also at -O0
+    static bool isRequired() { return true; }
+};
+
+}  // namespace
+
+llvm::PassPluginLibraryInfo getErrorFinderPassPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "ErrorFinderSummaryPass", LLVM_VERSION_STRING,
+            [](llvm::PassBuilder& PB) {
+                PB.registerPipelineParsingCallback(
+                    [](llvm::StringRef name, llvm::ModulePassManager& MPM,
+                       llvm::ArrayRef<llvm::PassBuilder::PipelineElement>) {
+                        if (name == "error-finder-summary") {
+                            MPM.addPass(ErrorFinderSummaryPass());
+                            return true;
+                        }
+                        return false;
+                    });
+                PB.registerOptimizerLastEPCallback(
+                    [](llvm::ModulePassManager& MPM, auto) {
+                        MPM.addPass(ErrorFinderSummaryPass());
+                    });
+            }};
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo
+llvmGetPassPluginInfo() {
+    return getErrorFinderPassPluginInfo();
+}
@@ -4,6 +4,12 @@
 #include "utils.hpp"
 
 #include "fault_point_info.h"
+#include "FaultSiteSummary.hpp"
+#include "module_index.h"
+#include "symbol_table.h"
+
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/Support/ThreadPool.h>
 
 #include <tuple>
 
@@ -11,11 +17,10 @@
 void recordFaultSiteInfo(mfuzz::FaultPointInfo& info, llvm::Function& callee, llvm::CallInst& callInst, int serial, int returnValue) {
     using namespace mfuzz;
 
-    info.setLocationInfo(callInst);
-
-    std::string calleeName= callee.getName().str();
+    // source code is read only for the sites that are reported
+    info.setLocationInfo(callInst, false);
 
-    info.calleeName = calleeName;
+    info.calleeName = callee.getName().str();
     info.serialNumber = serial;
     info.returnValue = returnValue;
 
@@ -25,169 +30,135 @@ void recordFaultSiteInfo(mfuzz::FaultPointInfo& info, llvm::Function& callee, ll
 
 }
 
-struct State {
-    bool hasVisited(llvm::BasicBlock* BB) { return std::find(trace.begin(), trace.end(), BB) != trace.end(); }
-    std::vector<llvm::BasicBlock*> trace;
-    llvm::Instruction* pc;
-};
-
-bool run(State& state, TaintSet taintSet) {
+// whether the return value of InsPtr is compared against 0/NULL or
+// switched on, on some path after the call
+bool isCheckRet(llvm::CallInst* InsPtr, TaintDataflow& dataflow) {
     using namespace llvm;
-    while (state.pc) {
-        if (state.pc->isCast()) {
-            Value* operand1 = state.pc->getOperand(0);
-            if (taintSet.exists(operand1)) {
-                taintSet.insert(state.pc);
-            }
-            state.pc = state.pc->getNextNode();
-            continue;
-        }
-        unsigned opcode = state.pc->getOpcode();
-        switch (opcode) {
-            case Instruction::Store: {
-                StoreInst* storeinst = cast<StoreInst>(state.pc);
-                Value* operand1 = storeinst->getOperand(0);
-                Value* operand2 = storeinst->getOperand(1);
-                // Checking if the taintedVars vector contains this input.
-                if (taintSet.exists(operand1)) {
-                    taintSet.insertBackToGetElement(operand2);
-                } else {
-                    taintSet.remove(operand2);
-                }
-                break;
-            }
-            case Instruction::Load: {
-                LoadInst* loadinst = cast<LoadInst>(state.pc);
-                Value* operand = loadinst->getOperand(0);
-                if (taintSet.exists(operand)) {
-                    taintSet.insert(loadinst);
-                }
-                break;
-            }
-            case llvm::Instruction::GetElementPtr: {
-                GetElementPtrInst* gepinst = cast<GetElementPtrInst>(state.pc);
-                Value* operand = gepinst->getOperand(0);
-                Value* offsetVal = gepinst->getOperand(gepinst->getNumOperands() - 1);
-                int offset = 0;
-                if (auto* constOffsetVal = dyn_cast<ConstantInt>(offsetVal)) {
-                    offset = constOffsetVal->getSExtValue();
-                }
-                if (taintSet.exists(Taint(operand, offset))) {
-                    taintSet.insert(gepinst);
-                }
-                break;
-            }
-            case Instruction::ICmp: {
-                ICmpInst* icmpinst = cast<ICmpInst>(state.pc);
-                Value* operand1 = icmpinst->getOperand(0);
-                Value* operand2 = icmpinst->getOperand(1);
-                if (!isa<ConstantData>(operand1)) {
-                    std::swap(operand1, operand2);
-                }
-                if ((isa<ConstantInt>(operand1) && cast<ConstantInt>(operand1)->isZero()) ||
-                    isa<ConstantPointerNull>(operand1)) {
-                    if (taintSet.exists(operand2)) {
-                        return true;
-                    }
-                }
-                break;
-            }
-            case Instruction::Switch: {
-                SwitchInst* switinst = cast<SwitchInst>(state.pc);
-                Value* operand1 = switinst->getOperand(0);
-                if (taintSet.exists(operand1)) {
-                    return true;
-                }
-                break;
-            }
-            case Instruction::Call: {
-                break;
+    TaintSet taintSet;
+    taintSet.insert(InsPtr);
+
+    return dataflow.reaches(InsPtr, taintSet, [&](Instruction& ins, const BitVector& state) {
+        if (auto* icmpinst = dyn_cast<ICmpInst>(&ins)) {
+            Value* operand1 = icmpinst->getOperand(0);
+            Value* operand2 = icmpinst->getOperand(1);
+            if (!isa<ConstantData>(operand1)) {
+                std::swap(operand1, operand2);
             }
-            default:
-                break;
+            return ((isa<ConstantInt>(operand1) && cast<ConstantInt>(operand1)->isZero()) ||
+                    isa<ConstantPointerNull>(operand1)) &&
+                   dataflow.isTainted(state, operand2);
         }
-
-        state.pc = state.pc->getNextNode();
-    }
-    BasicBlock* curBB = state.trace.back();
-    for (auto* BB : successors(curBB)) {
-        if (state.hasVisited(BB))  // avoid loop
-            continue;
-        if (state.trace.size() > 10)  // over deep is meaningless
-            continue;
-        state.trace.push_back(BB);
-        state.pc = &*BB->begin();
-        if (run(state, taintSet)) {
-            return true;
+        if (auto* switinst = dyn_cast<SwitchInst>(&ins)) {
+            return dataflow.isTainted(state, switinst->getCondition());
         }
-    }
-    state.trace.pop_back();
-    return false;
+        return false;
+    });
 }
 
 bool isCheckRet(llvm::CallInst* InsPtr) {
-    using namespace llvm;
-    TaintSet taintSet;
-    taintSet.insert(InsPtr);
-
-    BasicBlock* curBB = InsPtr->getParent();
-    Instruction* curIns = InsPtr->getNextNonDebugInstruction();
-    State state;
-    state.trace.push_back(curBB);
-    state.pc = curIns;
-    return run(state, taintSet);
+    TaintDataflow dataflow(*InsPtr->getFunction());
+    return isCheckRet(InsPtr, dataflow);
 }
 
 class AliasRecursiveAnalysis {
-    std::unordered_map<std::string, std::unordered_set<std::string>> uncheckedAliasMap;
+    static constexpr unsigned NO_CALLEE = ~0u;
+
+    // A call as the merge sees it: the symbol of its callee, and the node
+    // of the callee if the call is followed
+    struct CallEdge {
+        mfuzz::SymbolId callee;
+        unsigned node;
+    };
+
+    // The call graph of the functions being merged: a node per function
+    // definition, and an edge per call
+    std::vector<const FunctionSummary*> nodes;
+    std::vector<mfuzz::SymbolId> nodeSymbols;
+    std::vector<std::vector<CallEdge>> callEdges;
+    // per node, the external callees whose unchecked return value it
+    // returns, directly or through functions it calls
+    std::vector<llvm::DenseSet<mfuzz::SymbolId>> uncheckedAliasSets;
+    std::vector<bool> notInterested;  // by symbol, see isNotInterestedFuncName
 
     public: //result
     std::vector<mfuzz::FaultPointInfo> faultSiteInfoVec;
 
    public:
-    std::unordered_set<std::string> funcDefined;   // those who defined in our module and return type are int or pointer
-    std::unordered_set<std::string> funcExternal;  // not complete, but we skip those functions
-    std::unordered_map<std::string, std::tuple<int, int, int>> funcExternalCheckedTimes;
+    // names of the functions and callees merged; the tables below are
+    // indexed by their symbols
+    mfuzz::SymbolTable symbols;
+    std::vector<bool> funcDefined;   // those who defined in our module and return type are int or pointer
+    std::vector<bool> funcExternal;  // not complete, but we skip those functions
+    std::vector<std::tuple<int, int, int>> funcExternalCheckedTimes;
     bool deepMode = false;
     bool kernelMode = false;
+    // a call is checked when a compare of its value against 0/NULL or a
+    // switch on it is reachable by taint dataflow (isCheckRet), instead of
+    // when any alias of it is compared
+    bool taintChecks = false;
     // bool disableAliasAnalysis = false;
+    FaultSiteSummaryCache* summaryCache = nullptr;  // reuse summaries of unchanged modules
+    unsigned jobs = 1;  // threads summarizing functions (0 = all cores)
 
+   private:
+    std::unique_ptr<llvm::ThreadPool> pool;
 
-    public:
-    void analyze(std::unordered_map<std::string, std::unique_ptr<llvm::Module>>& filenameModuleMap) {
 
-        // classify functions
-        for (const auto& fileModulePair : filenameModuleMap) {
-            const std::string& fileName = fileModulePair.first;
-            llvm::Module& M = *filenameModuleMap[fileName].get();
-            analyzeModuleForFunctionClassification(M);
+    public:
+    void analyze(const std::unordered_map<std::string, mfuzz::ModuleIndex>& filenameIndexMap) {
+        // visit modules in file order, as the streaming mode does
+        std::vector<std::string> fileNames;
+        for (const auto& fileIndexPair : filenameIndexMap) {
+            fileNames.push_back(fileIndexPair.first);
         }
-
-
-        // get all interesting functions whose return value are finally checked
-        for (const auto& fileModulePair : filenameModuleMap) {
-            const std::string& fileName = fileModulePair.first;
-            llvm::Module& M = *filenameModuleMap[fileName].get();
-            analyzeModule(M);
+        std::sort(fileNames.begin(), fileNames.end());
+
+        startPool();
+        std::vector<ModuleSummary> summaries;
+        for (const std::string& fileName : fileNames) {
+            getSummary(fileName, summaries, [&](ModuleSummary& summary) {
+                summary = summarizeModule(filenameIndexMap.at(fileName));
+                return true;
+            });
         }
+        mergeSummaries(summaries);
+    }
 
-
-        // get information of all interesting functions
-        for (const auto& fileModulePair : filenameModuleMap) {
-            const std::string& fileName = fileModulePair.first;
-            llvm::Module& M = *filenameModuleMap[fileName].get();
-            analyzeModuleForContext(M);
+    // Streaming mode: modules are loaded lazily, one at a time, and only
+    // their summaries are kept. Modules found in the summary cache are not
+    // loaded at all.
+    void analyzeLazily(const std::vector<std::string>& fileNames) {
+        startPool();
+        std::vector<ModuleSummary> summaries;
+        for (const std::string& fileName : fileNames) {
+            getSummary(fileName, summaries, [&](ModuleSummary& summary) {
+                return mfuzz::visitLazyModule(fileName, [&](llvm::Module& M) {
+                    summary = summarizeModule(mfuzz::ModuleIndex(M));
+                });
+            });
         }
+        mergeSummaries(summaries);
     }
 
-   private:
-    void analyzeModuleForFunctionClassification(llvm::Module& M) {
-        for (auto& F : M) {
-            std::string funcName = mfuzz::getDefinedFuncName(&F);
+    // (total, checked, directly checked) calls of calleeName
+    std::tuple<int, int, int> getCheckedTimes(const std::string& calleeName) const {
+        mfuzz::SymbolId callee = symbols.lookup(calleeName);
+        if (callee == mfuzz::SymbolTable::NO_SYMBOL)
+            return {0, 0, 0};
+        return funcExternalCheckedTimes[callee];
+    }
+
+    // Collects what the analysis needs to know about every function with a
+    // body: how it is classified and, for each call, whether the return
+    // value is checked or returned.
+    ModuleSummary summarizeModule(const mfuzz::ModuleIndex& index) {
+        ModuleSummary summary;
+        for (const mfuzz::FunctionIndex& func : index.functions) {
+            llvm::Function& F = *func.function;
+            FunctionSummary& funcSummary = summary.functions.emplace_back();
+            funcSummary.name = func.name;
+            funcSummary.retPointerOrInt = mfuzz::isRetPointerOrInt(&F);
 
-            if(funcName.empty())
-                continue;
-            
             // kernel mode
             if (kernelMode) {
                 llvm::StringRef filenameRef = getSourceFileNameRef(F);
@@ -196,169 +167,381 @@ class AliasRecursiveAnalysis {
                 }
                 // those who defined in kernel headers, we count them as external function
                 // though they seem to be in our module
-                if (filenameRef.endswith(".h") && filenameRef.contains("include/")) {
-                    funcExternal.insert(funcName);
-                    std::cout << "[DEBUG] set as external function: " << funcName << std::endl;
-                    continue;
-                }
+                funcSummary.kernelHeader = filenameRef.endswith(".h") && filenameRef.contains("include/");
             }
+        }
 
-            if (!mfuzz::isRetPointerOrInt(&F)) {
+        // Bodies are only read from here on, and each function writes its
+        // own summary, so functions can be summarized concurrently.
+        if (!pool || index.functions.size() < 2) {
+            for (size_t i = 0; i < index.functions.size(); i++)
+                summarizeFunction(index.functions[i], summary.functions[i]);
+        } else {
+            for (size_t i = 0; i < index.functions.size(); i++) {
+                pool->async([&, i] {
+                    summarizeFunction(index.functions[i], summary.functions[i]);
+                });
+            }
+            pool->wait();
+        }
+        return summary;
+    }
+
+    // The results of all modules from their summaries, in module order
+    void mergeSummaries(std::vector<ModuleSummary>& summaries) {
+        // names are hashed here once; from here on they are symbols
+        numberFunctions(summaries);
+
+        // classify functions
+        for (unsigned node = 0; node < nodes.size(); node++) {
+            const FunctionSummary& func = *nodes[node];
+            if (kernelMode && func.kernelHeader) {
+                funcExternal[nodeSymbols[node]] = true;
+                std::cout << "[DEBUG] set as external function: " << func.name << std::endl;
+                continue;
+            }
+
+            if (!func.retPointerOrInt) {
                 continue;
             }
 
-            funcDefined.insert(funcName);
+            funcDefined[nodeSymbols[node]] = true;
         }
-    }
 
-    void analyzeModule(llvm::Module& M) {
-        for (auto& F : M) {
+
+        // get all interesting functions whose return value are finally checked
+        resolveCallees(summaries);
+        for (const std::vector<unsigned>& scc : bottomUpSCCs()) {
+            // a function of the SCC may return what any other one returns
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (unsigned node : scc)
+                    changed |= collectUncheckedAliases(node);
+            }
+        }
+        for (unsigned node = 0; node < nodes.size(); node++) {
             // skip if we count them as external function
-            if (funcExternal.count(F.getName().str())) {
+            if (funcExternal[nodeSymbols[node]]) {
                 continue;
             }
-            analyzeFunctionAndGetUncheckedAliasSet(F);
+            countCheckedCalls(node);
         }
-    }
 
-    void analyzeModuleForContext(llvm::Module& M) {
-        for (auto& F : M) {
+
+        // get information of all interesting functions
+        for (unsigned node = 0; node < nodes.size(); node++) {
             // skip if we count them as external function
-            if (funcExternal.count(F.getName().str())) {
+            if (funcExternal[nodeSymbols[node]]) {
                 continue;
             }
             // Number of occurrences of function
-            std::unordered_map<std::string, int> functionSerialMap;
-            for (auto& BB : F) {
-                for (auto& Ins : BB) {
-                    auto calleePtr = mfuzz::getCalledFunc(&Ins);
-                    if (!calleePtr || !mfuzz::isRetPointerOrInt(calleePtr) || !Ins.getDebugLoc())
-                        continue;
+            llvm::DenseMap<mfuzz::SymbolId, int> functionSerialMap;
+            const std::vector<CallSummary>& calls = nodes[node]->calls;
+            for (size_t i = 0; i < calls.size(); i++) {
+                mfuzz::SymbolId callee = callEdges[node][i].callee;
+                auto& [_1, checked, _2] = funcExternalCheckedTimes[callee];
+
+                // we skip if never checked
+                if (!checked)
+                    continue;
 
-                    llvm::CallInst& callInst = *llvm::dyn_cast<llvm::CallInst>(&Ins);
-                    std::string calleeName = calleePtr->getName().str();
+                int& serial = functionSerialMap[callee];
+                serial++;
+                mfuzz::FaultPointInfo& info = faultSiteInfoVec.emplace_back(calls[i].site);
+                info.serialNumber = serial;
+                if (mfuzz::InstructionLocationInfo::outputSourceCode)
+                    info.loadSourceCode();
+            }
+        }
+    }
 
-                    auto iter = funcExternalCheckedTimes.find(calleeName);
-                    if (iter == funcExternalCheckedTimes.end()) {
-                        continue;
-                    }
+    // Sorts the fault sites that are checked somewhere, with their counts,
+    // and writes them to <outputPath>.faultsite, and with binary also to
+    // <outputPath>.faultsite.bin
+    void writeResults(const std::string& outputPath, bool binary) {
+        using mfuzz::FaultPointInfo;
+        using mfuzz::InstructionLocationInfo;
+        std::ofstream outfile(outputPath + ".faultsite");
+
+        std::sort(faultSiteInfoVec.begin(),
+                  faultSiteInfoVec.end(),
+                  [](const FaultPointInfo& info1, const FaultPointInfo& info2) {
+                      // static functions may share a name across files
+                      return std::tie(info1.calleeName, info1.functionName,
+                                      info1.serialNumber, info1.fileName,
+                                      info1.lineNumber) <
+                             std::tie(info2.calleeName, info2.functionName,
+                                      info2.serialNumber, info2.fileName,
+                                      info2.lineNumber);
+                  });
+
+        std::vector<FaultPointInfo> finalVec;
+
+        for (FaultPointInfo& info : faultSiteInfoVec) {
+            auto [total, checked, direct] = getCheckedTimes(info.calleeName);
+
+            if (!checked) {  // never checked, not necessary though
+                continue;
+            }
+            info.faultSiteNum = total;
+            info.checkedNum = checked;
+            info.directNum = direct;
 
-                    auto& [_1, checked, _2] = iter->second;
+            finalVec.push_back(info);
+        }
 
-                    // we skip if never checked
-                    if (!checked)
-                        continue;
+        InstructionLocationInfo::output_vector(outfile, finalVec);
+        if (binary) {
+            std::ofstream binfile(outputPath + ".faultsite.bin", std::ios::binary);
+            InstructionLocationInfo::output_vector(binfile, finalVec, true);
+        }
+    }
 
-                    int errorReturnValue;
-                    if (calleePtr->getReturnType()->isPointerTy()) {
-                        errorReturnValue=0;
-                    } else {
-                        if (kernelMode) {
-                            errorReturnValue = -12; //-ENOMEM
-                        } else {
-                            errorReturnValue = -1;
-                        }
-                    }
+   private:
+    void startPool() {
+        if (jobs != 1 && !pool)
+            pool = std::make_unique<llvm::ThreadPool>(llvm::hardware_concurrency(jobs));
+    }
+
+    template <typename Summarize>
+    void getSummary(const std::string& fileName, std::vector<ModuleSummary>& summaries, Summarize summarize) {
+        std::string key;
+        if (summaryCache) {
+            key = summaryCache->key(fileName);
+            if (std::optional<ModuleSummary> cached = summaryCache->load(key)) {
+                summaries.push_back(std::move(*cached));
+                return;
+            }
+        }
 
-                    functionSerialMap[calleeName]++;
-                    recordFaultSiteInfo(faultSiteInfoVec.emplace_back(), *calleePtr, callInst,
-                                        functionSerialMap[calleeName], errorReturnValue);
+        ModuleSummary summary;
+        if (!summarize(summary))
+            return;
+        if (summaryCache)
+            summaryCache->store(key, summary);
+        summaries.push_back(std::move(summary));
+    }
+
+    void summarizeFunction(const mfuzz::FunctionIndex& func, FunctionSummary& funcSummary) {
+        // built on the first call site, then shared by all of them
+        std::optional<FunctionAliasIndex> aliasIndex;
+        std::optional<TaintDataflow> dataflow;
+        for (const mfuzz::IndexedCall& indexedCall : func.calls) {
+            llvm::Function* calleePtr = indexedCall.callee;
+            llvm::CallInst& callInst = *indexedCall.inst;
+            CallSummary& call = funcSummary.calls.emplace_back();
+
+            int errorReturnValue;
+            if (calleePtr->getReturnType()->isPointerTy()) {
+                errorReturnValue=0;
+            } else {
+                if (kernelMode) {
+                    errorReturnValue = -12; //-ENOMEM
+                } else {
+                    errorReturnValue = -1;
                 }
             }
+            recordFaultSiteInfo(call.site, *calleePtr, callInst, 0, errorReturnValue);
+
+            // a lazily loaded callee is not a declaration either
+            call.calleeDefinedHere = !calleePtr->isDeclaration();
+
+            if (mfuzz::isNotInterestedFuncName(calleePtr->getName()))
+                continue;
+
+            if (!aliasIndex)
+                aliasIndex.emplace(func.function);
+            if (taintChecks) {
+                if (!dataflow)
+                    dataflow.emplace(*func.function);
+                call.checked = isCheckRet(&callInst, *dataflow);
+            } else {
+                call.checked = isValueUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst, *aliasIndex);
+            }
+            call.directlyChecked = isValueDirectlyUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst);
+            call.returned = isValueUsedBy<llvm::ReturnInst>(callInst, *aliasIndex);
         }
     }
-    private:
-    std::unordered_set<std::string>& analyzeFunctionAndGetUncheckedAliasSet(llvm::Function& func) {
-        std::string key = mfuzz::getDefinedFuncName(&func);
-        auto iter = uncheckedAliasMap.find(key);
-        if (iter != uncheckedAliasMap.end()) {
-            // if we have done analysis, return the unchecked alias set immediately
-            return iter->second;
+
+    // Gives every function definition a node, and every name of a
+    // function or callee a symbol
+    void numberFunctions(const std::vector<ModuleSummary>& summaries) {
+        nodes.clear();
+        nodeSymbols.clear();
+        callEdges.clear();
+        uncheckedAliasSets.clear();
+        for (const ModuleSummary& summary : summaries) {
+            for (const FunctionSummary& func : summary.functions) {
+                nodes.push_back(&func);
+                nodeSymbols.push_back(symbols.intern(func.name));
+                std::vector<CallEdge>& edges = callEdges.emplace_back();
+                edges.reserve(func.calls.size());
+                for (const CallSummary& call : func.calls) {
+                    edges.push_back({symbols.intern(call.site.calleeName), NO_CALLEE});
+                }
+            }
+        }
+        uncheckedAliasSets.resize(nodes.size());
+
+        funcDefined.resize(symbols.size());
+        funcExternal.resize(symbols.size());
+        funcExternalCheckedTimes.resize(symbols.size());
+        for (mfuzz::SymbolId symbol = notInterested.size(); symbol < symbols.size(); symbol++) {
+            notInterested.push_back(mfuzz::isNotInterestedFuncName(symbols.name(symbol)));
         }
-        // do recursive analysis
-        std::unordered_set<std::string>& uncheckedAliasSet = uncheckedAliasMap[key];
-        std::string funcName = mfuzz::getDefinedFuncName(&func);
-        for (auto& BB : func) {
-            for (auto& Ins : BB) {
-                auto calleePtr = mfuzz::getCalledFunc(&Ins);
-                if (!calleePtr || !mfuzz::isRetPointerOrInt(calleePtr) || !Ins.getDebugLoc())
+    }
+
+    // Links the calls followed in deep mode to the node of their callee
+    void resolveCallees(const std::vector<ModuleSummary>& summaries) {
+        if (!deepMode)
+            return;
+        unsigned node = 0;
+        for (const ModuleSummary& summary : summaries) {
+            unsigned moduleEnd = node + summary.functions.size();
+            llvm::DenseMap<mfuzz::SymbolId, unsigned> localFunctions;
+            for (unsigned local = node; local < moduleEnd; local++) {
+                localFunctions[nodeSymbols[local]] = local;
+            }
+            for (; node < moduleEnd; node++) {
+                const std::vector<CallSummary>& calls = nodes[node]->calls;
+                for (size_t i = 0; i < calls.size(); i++) {
+                    CallEdge& edge = callEdges[node][i];
+                    // deep into if the callee is our own function; one only
+                    // declared in the module is followed no further
+                    if (!calls[i].calleeDefinedHere || !funcDefined[edge.callee])
+                        continue;
+                    auto calleeIter = localFunctions.find(edge.callee);
+                    if (calleeIter != localFunctions.end())
+                        edge.node = calleeIter->second;
+                }
+            }
+        }
+    }
+
+    // Strongly connected components of the call graph, callees before
+    // their callers (Tarjan's algorithm, with an explicit stack so that
+    // deep call chains cannot overflow ours)
+    std::vector<std::vector<unsigned>> bottomUpSCCs() const {
+        std::vector<std::vector<unsigned>> sccs;
+        std::vector<unsigned> index(nodes.size(), NO_CALLEE);
+        std::vector<unsigned> lowLink(nodes.size());
+        std::vector<bool> onStack(nodes.size(), false);
+        std::vector<unsigned> sccStack;
+        // the nodes being visited, with the next call of each to follow
+        std::vector<std::pair<unsigned, unsigned>> visitStack;
+        unsigned nextIndex = 0;
+
+        for (unsigned root = 0; root < nodes.size(); root++) {
+            if (index[root] != NO_CALLEE)
+                continue;
+            visitStack.emplace_back(root, 0);
+            while (!visitStack.empty()) {
+                auto& [node, nextCall] = visitStack.back();
+                if (nextCall == 0 && index[node] == NO_CALLEE) {
+                    index[node] = lowLink[node] = nextIndex++;
+                    sccStack.push_back(node);
+                    onStack[node] = true;
+                }
+                if (nextCall < callEdges[node].size()) {
+                    unsigned callee = callEdges[node][nextCall++].node;
+                    if (callee == NO_CALLEE)
+                        continue;
+                    if (index[callee] == NO_CALLEE)
+                        visitStack.emplace_back(callee, 0);
+                    else if (onStack[callee])
+                        lowLink[node] = std::min(lowLink[node], index[callee]);
                     continue;
+                }
+
+                unsigned done = node;
+                visitStack.pop_back();
+                if (!visitStack.empty()) {
+                    unsigned caller = visitStack.back().first;
+                    lowLink[caller] = std::min(lowLink[caller], lowLink[done]);
+                }
+                if (lowLink[done] == index[done]) {
+                    std::vector<unsigned>& scc = sccs.emplace_back();
+                    unsigned member;
+                    do {
+                        member = sccStack.back();
+                        sccStack.pop_back();
+                        onStack[member] = false;
+                        scc.push_back(member);
+                    } while (member != done);
+                }
+            }
+        }
+        return sccs;
+    }
 
-                llvm::CallInst& callInst = *llvm::dyn_cast<llvm::CallInst>(&Ins);
+    // Adds to the unchecked alias set of node what its calls return
+    // unchecked; true if the set grew
+    bool collectUncheckedAliases(unsigned node) {
+        llvm::DenseSet<mfuzz::SymbolId>& uncheckedAliasSet = uncheckedAliasSets[node];
+        size_t oldSize = uncheckedAliasSet.size();
+        const std::vector<CallSummary>& calls = nodes[node]->calls;
+        for (size_t i = 0; i < calls.size(); i++) {
+            const CallSummary& call = calls[i];
+            const CallEdge& edge = callEdges[node][i];
+            if (notInterested[edge.callee] || !call.returned)
+                continue;
+
+            if (funcDefined[edge.callee]) {
+                if (!call.checked && edge.node != NO_CALLEE && edge.node != node) {
+                    const llvm::DenseSet<mfuzz::SymbolId>& calleeUncheckedAliasSet = uncheckedAliasSets[edge.node];
+                    uncheckedAliasSet.insert(calleeUncheckedAliasSet.begin(), calleeUncheckedAliasSet.end());
+                }
+            } else if (!call.directlyChecked && !call.checked) {
+                uncheckedAliasSet.insert(edge.callee);
+            }
+        }
+        return uncheckedAliasSet.size() != oldSize;
+    }
+
+    // Counts the calls of node to functions whose return value it checks,
+    // seeing through checked calls of our own functions in deep mode
+    void countCheckedCalls(unsigned node) {
+        const std::string& funcName = nodes[node]->name;
+        const std::vector<CallSummary>& calls = nodes[node]->calls;
+        for (size_t i = 0; i < calls.size(); i++) {
+            const CallSummary& call = calls[i];
+            const CallEdge& edge = callEdges[node][i];
+            if (notInterested[edge.callee])
+                continue;
 
-                if (mfuzz::isNotInterestedFuncName(calleePtr->getName()))
+            if (funcDefined[edge.callee]) {
+                if(!deepMode){
+                    // DO NOT do deep analysis if we are not in deep mode
                     continue;
-                std::string calleeName = calleePtr->getName().str();
-
-               
-                bool returnValueChecked;
-                bool returnValueDirectlyChecked;
-
-                returnValueChecked = isValueUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst,func);
-                returnValueDirectlyChecked = isValueDirectlyUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst);
-
-
-                // if (disableAliasAnalysis) {
-                //     returnValueChecked = isValueDirectlyUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst);
-                // } else {
-                //     returnValueChecked = isValueUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst,func);
-                // }
-
-                // if(kernelMode){
-                //     // skip checking if comparator is zero or nullptr on purpose
-                //     returnValueChecked = isValueUsedBy<llvm::SwitchInst,llvm::ICmpInst>(callInst,func);
-                // }else{
-                //     returnValueChecked = isCheckRet(&callInst); // compatible with old version
-                // }
-                
-                bool returnValueReturned = isValueUsedBy<llvm::ReturnInst>(callInst, func);
-                
-                if (funcDefined.count(calleeName)) {
-                    if(!deepMode){
-                        // DO NOT do deep analysis if we are not in deep mode
+                }
+                if (call.checked) {
+                    llvm::dbgs() << "function checked (internal, skipped): " << call.site.calleeName << " in " << funcName<<"\n";
+                    if (edge.node == NO_CALLEE)
                         continue;
-                    }
-                    // deep into if the callee is our own function
-                    std::unordered_set<std::string>& calleeUncheckedAliasSet =
-                        analyzeFunctionAndGetUncheckedAliasSet(*calleePtr);
-                    if (returnValueChecked) {
-                        llvm::dbgs() << "function checked (internal, skipped): " << calleeName << " in " << funcName<<"\n";
-                        for (auto& func : calleeUncheckedAliasSet) {
-                            auto& [total, checked, direct] = funcExternalCheckedTimes[func];
-                            total++;
-                            checked++;
-                            llvm::dbgs() << "function checked (recursively): " << func << " in " << funcName << "\n";
-                        }
-                    } else {
-                        if (returnValueReturned){
-                            uncheckedAliasSet.insert(calleeUncheckedAliasSet.begin(), calleeUncheckedAliasSet.end());
-                        }
-                    }
-
-                } else {  // otherwise we have reached the bottom
-                    auto& [total, checked, direct] = funcExternalCheckedTimes[calleeName];
-                    total++;
-                    if (returnValueDirectlyChecked) {
-                        direct++;
+                    for (mfuzz::SymbolId func : uncheckedAliasSets[edge.node]) {
+                        auto& [total, checked, direct] = funcExternalCheckedTimes[func];
+                        total++;
                         checked++;
-                        llvm::dbgs() << "function checked (external, directly): " << calleeName << " in " << funcName << "\n";
-                    } else if (returnValueChecked) {
-                        checked++;
-                        llvm::dbgs() << "function checked (external, alias): " << calleeName << " in " << funcName << "\n";
-                    } else {
-                        if (returnValueReturned){
-                            uncheckedAliasSet.insert(calleeName);
-                        }
-                            
+                        llvm::dbgs() << "function checked (recursively): " << symbols.name(func) << " in " << funcName << "\n";
                     }
                 }
+
+            } else {  // otherwise we have reached the bottom
+                auto& [total, checked, direct] = funcExternalCheckedTimes[edge.callee];
+                total++;
+                if (call.directlyChecked) {
+                    direct++;
+                    checked++;
+                    llvm::dbgs() << "function checked (external, directly): " << call.site.calleeName << " in " << funcName << "\n";
+                } else if (call.checked) {
+                    checked++;
+                    llvm::dbgs() << "function checked (external, alias): " << call.site.calleeName << " in " << funcName << "\n";
+                }
             }
         }
-        return uncheckedAliasSet;
     }
 
-   
-
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+#ifndef ANALYZER_FAULTSITESUMMARY_HPP
+#define ANALYZER_FAULTSITESUMMARY_HPP
+
+#include "fault_point_info.h"
+
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <optional>
+
+// What the fault site analysis needs to know about one module. Everything
+// here is local to the module; the global state (funcDefined, funcExternal,
+// the check counters) is rebuilt from the summaries of all modules, so a
+// summary can be cached and reused as long as its bitcode is unchanged.
+
+// A call to a function returning an int or a pointer, with debug info
+struct CallSummary {
+    mfuzz::FaultPointInfo site;     // serialNumber is assigned when merging
+    bool calleeDefinedHere = false;  // callee has a body in this module
+    bool checked = false;
+    bool directlyChecked = false;
+    bool returned = false;
+
+    void fill_ptree(ptree& pt) {
+        site.fill_ptree(pt);
+        pt.put("calleeDefinedHere", calleeDefinedHere);
+        pt.put("checked", checked);
+        pt.put("directlyChecked", directlyChecked);
+        pt.put("returned", returned);
+    }
+
+    void extract_ptree(ptree& pt) {
+        site.extract_ptree(pt);
+        calleeDefinedHere = pt.get<bool>("calleeDefinedHere");
+        checked = pt.get<bool>("checked");
+        directlyChecked = pt.get<bool>("directlyChecked");
+        returned = pt.get<bool>("returned");
+    }
+};
+
+// A function with a body, and its calls in instruction order
+struct FunctionSummary {
+    std::string name;
+    bool retPointerOrInt = false;
+    bool kernelHeader = false;  // defined in a kernel header (kernel mode)
+    std::vector<CallSummary> calls;
+
+    void fill_ptree(ptree& pt) {
+        pt.put("name", name);
+        pt.put("retPointerOrInt", retPointerOrInt);
+        pt.put("kernelHeader", kernelHeader);
+        ptree children;
+        for (CallSummary& call : calls) {
+            ptree child;
+            call.fill_ptree(child);
+            children.push_back(std::make_pair("", child));
+        }
+        pt.add_child("calls", children);
+    }
+
+    void extract_ptree(ptree& pt) {
+        name = pt.get<std::string>("name");
+        retPointerOrInt = pt.get<bool>("retPointerOrInt");
+        kernelHeader = pt.get<bool>("kernelHeader");
+        for (auto& item : pt.get_child("calls")) {
+            calls.emplace_back().extract_ptree(item.second);
+        }
+    }
+};
+
+struct ModuleSummary {
+    std::vector<FunctionSummary> functions;
+
+    void fill_ptree(ptree& pt) {
+        ptree children;
+        for (FunctionSummary& func : functions) {
+            ptree child;
+            func.fill_ptree(child);
+            children.push_back(std::make_pair("", child));
+        }
+        pt.add_child("functions", children);
+    }
+
+    void extract_ptree(ptree& pt) {
+        for (auto& item : pt.get_child("functions")) {
+            functions.emplace_back().extract_ptree(item.second);
+        }
+    }
+};
+
+// Writes pt as JSON to a file aside and renames it to path, so that
+// concurrent readers never see a partial file
+bool writeJsonFileAtomically(const std::filesystem::path& path, const ptree& pt) {
+    std::filesystem::path tmpPath = path;
+    tmpPath += "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream outfile(tmpPath);
+        write_json(outfile, pt, false);
+        if (!outfile) {
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+// On-disk cache of module summaries, one JSON file per module named after
+// the MD5 of its bitcode. Options that change the summary are mixed into
+// the key, as is kVersion, which must be bumped whenever the summary or the
+// way it is computed changes.
+class FaultSiteSummaryCache {
+    static constexpr char const* kVersion = "1";
+
+    std::filesystem::path dir;
+    std::string salt;
+
+   public:
+    unsigned hits = 0;
+    unsigned misses = 0;
+
+    FaultSiteSummaryCache(const std::string& dirName, bool kernelMode, bool taintChecks)
+        : dir(dirName),
+          salt(std::string(kVersion) + (kernelMode ? "k" : "u") + (taintChecks ? "t" : "a")) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+    }
+
+    // the key of fileName, empty if it cannot be read
+    std::string key(const std::string& fileName) {
+        auto bufferOrErr = llvm::MemoryBuffer::getFile(fileName);
+        if (!bufferOrErr)
+            return "";
+        llvm::MD5 hash;
+        hash.update(salt);
+        hash.update((*bufferOrErr)->getBuffer());
+        llvm::MD5::MD5Result result;
+        hash.final(result);
+        return result.digest().str().str();
+    }
+
+    std::optional<ModuleSummary> load(const std::string& key) {
+        std::ifstream infile(dir / (key + ".json"));
+        if (key.empty() || !infile) {
+            misses++;
+            return std::nullopt;
+        }
+        ModuleSummary summary;
+        try {
+            ptree pt;
+            read_json(infile, pt);
+            summary.extract_ptree(pt);
+        } catch (...) {
+            // truncated or from an incompatible build; just recompute
+            misses++;
+            return std::nullopt;
+        }
+        hits++;
+        return summary;
+    }
+
+    void store(const std::string& key, ModuleSummary& summary) {
+        if (key.empty())
+            return;
+        ptree pt;
+        summary.fill_ptree(pt);
+
+        // concurrent runs never see a partial entry
+        std::filesystem::path path = dir / (key + ".json");
+        if (!writeJsonFileAtomically(path, pt)) {
+            llvm::errs() << "WARNING: cannot write summary cache entry " << path.string() << "\n";
+        }
+    }
+};
+
+#endif
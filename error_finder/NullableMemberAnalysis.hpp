@@ -5,328 +5,420 @@
 
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/Support/ThreadPool.h>
 #include <iomanip>
+#include <mutex>
 
 #include "fault_point_info.h"
+#include "NullableMemberSummary.hpp"
+#include "module_index.h"
+#include "symbol_table.h"
 #include "utils.hpp"
 
 class NullableMemberAnalysis {
+    // A pointer member: a symbol of typeNames for the struct type that
+    // holds it, and its byte offset there
+    using MemberKey = std::pair<mfuzz::SymbolId, int>;
+    static constexpr MemberKey NO_MEMBER = {mfuzz::SymbolTable::NO_SYMBOL, 0};
+
     // just checked
-    std::set<std::string> checkNullMemberSet;
+    llvm::DenseSet<MemberKey> checkNullMemberSet;
+
+    // names of the struct types members belong to, shared by all modules
+    mfuzz::SymbolTable typeNames;
+    std::mutex typeNamesLock;
+    std::mutex dbgsLock;
 
    public:
     // set null somewhere
     std::vector<mfuzz::NullableMemberInfo> nullableMemberVector;
+    unsigned jobs = 1;  // threads analyzing modules (0 = all cores)
 
    public:
-    void analyze(std::unordered_map<std::string, std::unique_ptr<llvm::Module>>&
-                     filenameModuleMap) {
-        for (const auto& fileModulePair : filenameModuleMap) {
-            const std::string& fileName = fileModulePair.first;
-            llvm::Module& M = *filenameModuleMap[fileName].get();
-            analyzeModuleForNullCheckedMembers(M);
+    void analyze(const std::unordered_map<std::string, mfuzz::ModuleIndex>&
+                     filenameIndexMap) {
+        std::vector<const mfuzz::ModuleIndex*> indexes;
+        std::vector<std::string> fileNames;
+        for (const auto& fileIndexPair : filenameIndexMap) {
+            fileNames.push_back(fileIndexPair.first);
         }
-
-        for (const auto& fileModulePair : filenameModuleMap) {
-            const std::string& fileName = fileModulePair.first;
-            llvm::Module& M = *filenameModuleMap[fileName].get();
-            analyzeModuleForNullableMembers(M);
+        std::sort(fileNames.begin(), fileNames.end());
+        for (const std::string& fileName : fileNames) {
+            indexes.push_back(&filenameIndexMap.at(fileName));
         }
 
-        std::cout << "NullableMemberAnalysis: " << checkNullMemberSet.size()
-                  << " member checked null" << std::endl;
+        runPhases(indexes.size(), [&](size_t i, auto visit) {
+            visit(*indexes[i]);
+        });
+    }
 
-        std::cout << "NullableMemberAnalysis: " << nullableMemberVector.size()
-                  << " nullable members found" << std::endl;
+    // Streaming mode: both phases reload the modules lazily; only
+    // checkNullMemberSet is kept between them. With several jobs, that
+    // many modules are loaded at a time.
+    void analyzeLazily(const std::vector<std::string>& fileNames) {
+        runPhases(fileNames.size(), [&](size_t i, auto visit) {
+            mfuzz::visitLazyModule(fileNames[i], [&](llvm::Module& M) {
+                visit(mfuzz::ModuleIndex(M));
+            });
+        });
     }
 
-   private:
-    struct SimpleNullableMemberInfo {
-        std::string parentTypeName;
-        int offset;
-    };
-    
-    // tbaa info
-    SimpleNullableMemberInfo getNullableMemberInfo(MDNode* metadata) {
-        SimpleNullableMemberInfo info;
-        // get the parent struct type and offset
-        auto parentTypeNode = dyn_cast<MDNode>(metadata->getOperand(0).get());
-        auto selfTypeNode = dyn_cast<MDNode>(metadata->getOperand(1).get());
-        auto selfOffset =
-            dyn_cast<ConstantAsMetadata>(metadata->getOperand(2).get());
-
-        if (!parentTypeNode || !selfTypeNode || !selfOffset) {
-            // llvm::dbgs()
-            //     << "not inject for metadata not being MDNode\n";
-            return {};
+    // What a module on its own tells; its stores are only reported once
+    // merged with the summaries of the other modules
+    NullableModuleSummary summarizeModule(const mfuzz::ModuleIndex& index) {
+        NullableModuleSummary summary;
+        std::vector<MemberKey> checkedMembers;
+        analyzeModuleForNullCheckedMembers(index, checkedMembers);
+        llvm::DenseSet<MemberKey> seen;
+        for (MemberKey member : checkedMembers) {
+            if (seen.insert(member).second)
+                summary.checkedMembers.emplace_back(getTypeName(member.first), member.second);
         }
 
-        auto parentTypeName =
-            dyn_cast<MDString>(parentTypeNode->getOperand(0).get());
-        auto selfTypeName =
-            dyn_cast<MDString>(selfTypeNode->getOperand(0).get());
-        auto selfOffsetValue = dyn_cast<ConstantInt>(selfOffset->getValue());
-
-        if (!parentTypeName || !selfTypeName || !selfOffsetValue) {
-            selfOffset->getValue()->print(llvm::dbgs());
-            llvm::dbgs() << "\n";
-            return {};
+        MemberDecoder decoder(*this);
+        for (const mfuzz::FunctionIndex& func : index.functions) {
+            for (llvm::StoreInst* storeIns : func.nullStores) {
+                MemberKey member = decoder.decode(storeIns);
+                if (member == NO_MEMBER) {
+                    continue;
+                }
+                mfuzz::NullableMemberInfo& nullableMemberInfo = summary.nullStores.emplace_back();
+                nullableMemberInfo.parentTypeName = getTypeName(member.first);
+                nullableMemberInfo.offset = member.second;
+                nullableMemberInfo.setLocationInfo(*storeIns, false);
+            }
         }
+        return summary;
+    }
 
-        auto parentTypeNameStr = parentTypeName->getString().str();
-        auto selfTypeNameStr = selfTypeName->getString().str();
-        auto selfOffsetInt = selfOffsetValue->getSExtValue();
-
-        if (selfTypeNameStr != "any pointer") {
-            return {};
+    // The results of all modules from their summaries, in module order
+    void mergeSummaries(std::vector<NullableModuleSummary>& summaries) {
+        for (NullableModuleSummary& summary : summaries) {
+            for (auto& [parentTypeName, offset] : summary.checkedMembers) {
+                checkNullMemberSet.insert({internTypeName(parentTypeName), offset});
+            }
         }
-
-        info.parentTypeName = parentTypeNameStr;
-        info.offset = selfOffsetInt;
-        return info;
-
+        for (NullableModuleSummary& summary : summaries) {
+            for (mfuzz::NullableMemberInfo& store : summary.nullStores) {
+                if (!checkNullMemberSet.count({internTypeName(store.parentTypeName), store.offset})) {
+                    continue;
+                }
+                mfuzz::NullableMemberInfo& nullableMemberInfo = nullableMemberVector.emplace_back(store);
+                if (mfuzz::InstructionLocationInfo::outputSourceCode)
+                    nullableMemberInfo.loadSourceCode();
+            }
+        }
+        printCounts();
     }
 
-    // gep info
-    SimpleNullableMemberInfo getNullableMemberInfo(llvm::GetElementPtrInst* gep) {
-        //llvm::dbgs() << "get gep info: \n";
-        SimpleNullableMemberInfo info;
-
-        llvm::Type* type = gep->getSourceElementType();
-
-        // get the parent struct type and offset
-        llvm::StructType* structType = llvm::dyn_cast<llvm::StructType>(type);
-        if (!structType) {
-            //std::cout << "not structType: " << info.parentTypeName << std::endl;
-            return {};
+    // Sorts the results and writes them to <outputPath>.nullable, and with
+    // binary also to <outputPath>.nullable.bin
+    void writeResults(const std::string& outputPath, bool binary) {
+        using mfuzz::InstructionLocationInfo;
+        using mfuzz::NullableMemberInfo;
+        std::ofstream outfile(outputPath + ".nullable");
+
+        std::sort(nullableMemberVector.begin(),
+                  nullableMemberVector.end(),
+                  [](const NullableMemberInfo& info1,
+                     const NullableMemberInfo& info2) {
+                      if (info1.parentTypeName == info2.parentTypeName) {
+                          if (info1.offset == info2.offset) {
+                              if (info1.functionName == info2.functionName) {
+                                  return std::tie(info1.serialNumber,
+                                                  info1.fileName,
+                                                  info1.lineNumber) <
+                                         std::tie(info2.serialNumber,
+                                                  info2.fileName,
+                                                  info2.lineNumber);
+                              }
+                              return info1.functionName < info2.functionName;
+                          }
+                          return info1.offset < info2.offset;
+                      }
+                      return info1.parentTypeName < info2.parentTypeName;
+                  });
+
+        InstructionLocationInfo::output_vector(outfile, nullableMemberVector);
+        if (binary) {
+            std::ofstream binfile(outputPath + ".nullable.bin", std::ios::binary);
+            InstructionLocationInfo::output_vector(binfile, nullableMemberVector, true);
         }
+    }
 
-        info.parentTypeName = structType->getStructName();
-        
-        // get rid of leading `struct.`
-        if (info.parentTypeName.find("struct.") == 0) {
-            info.parentTypeName = info.parentTypeName.substr(7);
+   private:
+    // Modules are analyzed independently, each into its own results, which
+    // are merged in module order once a phase is done
+    template <typename WithModule>
+    void runPhases(size_t moduleCount, WithModule withModule) {
+        std::vector<std::vector<MemberKey>> checkedMembers(moduleCount);
+        forEachModule(moduleCount, [&](size_t i) {
+            withModule(i, [&](const mfuzz::ModuleIndex& index) {
+                analyzeModuleForNullCheckedMembers(index, checkedMembers[i]);
+            });
+        });
+        for (const std::vector<MemberKey>& members : checkedMembers) {
+            checkNullMemberSet.insert(members.begin(), members.end());
         }
 
-        //std::cout << "parentTypeName: " << info.parentTypeName << std::endl;
-
-        int numOperands = gep->getNumOperands();
-        if (numOperands < 2) {
-            //std::cout << "numOperands < 2" << std::endl;
-            return {};
+        std::vector<std::vector<mfuzz::NullableMemberInfo>> nullableMembers(moduleCount);
+        forEachModule(moduleCount, [&](size_t i) {
+            withModule(i, [&](const mfuzz::ModuleIndex& index) {
+                analyzeModuleForNullableMembers(index, nullableMembers[i]);
+            });
+        });
+        for (std::vector<mfuzz::NullableMemberInfo>& members : nullableMembers) {
+            std::move(members.begin(), members.end(), std::back_inserter(nullableMemberVector));
         }
+        printCounts();
+    }
 
-        llvm::Value * memberOffset = gep->getOperand(numOperands - 2);
-        llvm::ConstantInt* memberOffsetInt = llvm::dyn_cast<llvm::ConstantInt>(memberOffset);
-        if (!memberOffsetInt) {
-            //std::cout << "not memberOffsetInt" << std::endl;
-            gep->print(llvm::dbgs());
-            llvm::dbgs() << "\n";
-            return {};
-        }
+    void printCounts() {
+        std::cout << "NullableMemberAnalysis: " << checkNullMemberSet.size()
+                  << " member checked null" << std::endl;
 
-        auto& dataLayout = gep->getFunction()->getParent()->getDataLayout();
-        const llvm::StructLayout * structLayout = dataLayout.getStructLayout(structType);
-        info.offset = structLayout->getElementOffset(memberOffsetInt->getSExtValue());
+        std::cout << "NullableMemberAnalysis: " << nullableMemberVector.size()
+                  << " nullable members found" << std::endl;
+    }
 
-        //std::cout << "offset: " << info.offset << std::endl;
+    template <typename Task>
+    void forEachModule(size_t moduleCount, Task task) {
+        if (jobs == 1 || moduleCount < 2) {
+            for (size_t i = 0; i < moduleCount; i++)
+                task(i);
+            return;
+        }
+        llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+        for (size_t i = 0; i < moduleCount; i++)
+            pool.async([&task, i] { task(i); });
+        pool.wait();
+    }
 
-        // array
+    mfuzz::SymbolId internTypeName(llvm::StringRef name) {
+        if (name.empty())
+            return mfuzz::SymbolTable::NO_SYMBOL;
+        std::lock_guard<std::mutex> guard(typeNamesLock);
+        return typeNames.intern(name);
+    }
 
-        return info;
+    std::string getTypeName(mfuzz::SymbolId type) {
+        std::lock_guard<std::mutex> guard(typeNamesLock);
+        return typeNames.name(type).str();
     }
-    SimpleNullableMemberInfo getNullableMemberInfo(llvm::Instruction* inst) {
-        SimpleNullableMemberInfo info;
 
-        // get Type Based Alias Analysis result
-        MDNode* metadata = inst->getMetadata("tbaa");
-        if (!metadata) {
-            return {};
-        }
+    // Tells which member a load or store accesses, from its TBAA tag or,
+    // for an untyped pointer, from the GEP it goes through. Decoded tags
+    // and fields are memoized; they belong to one module, so a decoder
+    // must not outlive it.
+    class MemberDecoder {
+        NullableMemberAnalysis& analysis;
+        mfuzz::SymbolId anyPointer;
+        llvm::DenseMap<llvm::MDNode*, MemberKey> tbaaMembers;
+        llvm::DenseMap<std::pair<llvm::StructType*, int64_t>, MemberKey> fieldMembers;
+
+       public:
+        explicit MemberDecoder(NullableMemberAnalysis& analysis)
+            : analysis(analysis), anyPointer(analysis.internTypeName("any pointer")) {}
+
+        MemberKey decode(llvm::Instruction* inst) {
+            // get Type Based Alias Analysis result
+            MDNode* metadata = inst->getMetadata(llvm::LLVMContext::MD_tbaa);
+            if (!metadata) {
+                return NO_MEMBER;
+            }
 
-        info = getNullableMemberInfo(metadata);
+            auto [iter, inserted] = tbaaMembers.try_emplace(metadata, NO_MEMBER);
+            if (inserted) {
+                iter->second = decodeTbaa(metadata);
+            }
+            MemberKey member = iter->second;
+
+            // array or garbage
+            if (member.first == anyPointer) {
+                // gep instruction
+                llvm::GetElementPtrInst* gepInst;
+                if (auto loadInst = llvm::dyn_cast<llvm::LoadInst>(inst)) {
+                    gepInst = dyn_cast<GetElementPtrInst>(loadInst->getPointerOperand());
+                } else if (auto storeInst = llvm::dyn_cast<llvm::StoreInst>(inst)) {
+                    gepInst = dyn_cast<GetElementPtrInst>(storeInst->getPointerOperand());
+                } else {
+                    return NO_MEMBER;
+                }
+
+                if (!gepInst) {
+                    return NO_MEMBER;
+                }
 
-        if(info.parentTypeName.empty()) {
-            return {};
+                member = decodeGep(gepInst);
+            }
+            return member;
         }
 
-        // array or garbage
-        if(info.parentTypeName == "any pointer"){
-
-            // gep instruction
-            llvm::GetElementPtrInst* gepInst;
-            if(auto loadInst = llvm::dyn_cast<llvm::LoadInst>(inst)) {
-                gepInst = dyn_cast<GetElementPtrInst>(loadInst->getPointerOperand());
-            }else if (auto storeInst = llvm::dyn_cast<llvm::StoreInst>(inst)) {
-                gepInst = dyn_cast<GetElementPtrInst>(storeInst->getPointerOperand());
-            } else {
-                return {};
+       private:
+        // tbaa info
+        MemberKey decodeTbaa(MDNode* metadata) {
+            if (metadata->getNumOperands() < 3) {
+                return NO_MEMBER;
+            }
+            // get the parent struct type and offset
+            auto parentTypeNode = dyn_cast<MDNode>(metadata->getOperand(0).get());
+            auto selfTypeNode = dyn_cast<MDNode>(metadata->getOperand(1).get());
+            auto selfOffset =
+                dyn_cast<ConstantAsMetadata>(metadata->getOperand(2).get());
+
+            if (!parentTypeNode || !selfTypeNode || !selfOffset) {
+                return NO_MEMBER;
             }
 
-            if(!gepInst) {
-                return {};
+            auto parentTypeName =
+                dyn_cast<MDString>(parentTypeNode->getOperand(0).get());
+            auto selfTypeName =
+                dyn_cast<MDString>(selfTypeNode->getOperand(0).get());
+            auto selfOffsetValue = dyn_cast<ConstantInt>(selfOffset->getValue());
+
+            if (!parentTypeName || !selfTypeName || !selfOffsetValue) {
+                std::lock_guard<std::mutex> guard(analysis.dbgsLock);
+                selfOffset->getValue()->print(llvm::dbgs());
+                llvm::dbgs() << "\n";
+                return NO_MEMBER;
             }
-            
-            info = getNullableMemberInfo(gepInst);
-            // std::cout << "gep info: " << info.parentTypeName << " " << info.offset << std::endl;
-        }
 
-        // std::cout << "get info: " << info.parentTypeName << " " << info.offset << std::endl;
-        return info;
-    }
+            if (selfTypeName->getString() != "any pointer") {
+                return NO_MEMBER;
+            }
 
-   private:
-    void analyzeModuleForNullCheckedMembers(llvm::Module& M) {
-        for (auto& F : M) {
-            std::string funcName = mfuzz::getDefinedFuncName(&F);
+            // anonymous structs have no name to report them by
+            if (parentTypeName->getString().empty()) {
+                return NO_MEMBER;
+            }
 
-            if (funcName.empty())
-                continue;
+            return {analysis.internTypeName(parentTypeName->getString()),
+                    static_cast<int>(selfOffsetValue->getSExtValue())};
+        }
 
-            for (auto& BB : F) {
-                for (auto itinst = BB.begin(); itinst != BB.end(); itinst++) {
-                    auto& Inst = *itinst;
+        // gep info
+        MemberKey decodeGep(llvm::GetElementPtrInst* gep) {
+            // get the parent struct type and offset
+            llvm::StructType* structType =
+                llvm::dyn_cast<llvm::StructType>(gep->getSourceElementType());
+            if (!structType) {
+                return NO_MEMBER;
+            }
 
-                    if (Inst.getOpcode() != Instruction::ICmp)
-                        continue;
+            int numOperands = gep->getNumOperands();
+            if (numOperands < 2) {
+                return NO_MEMBER;
+            }
 
-                    if (!Inst.getDebugLoc())
-                        continue;
+            llvm::Value* memberOffset = gep->getOperand(numOperands - 2);
+            llvm::ConstantInt* memberOffsetInt = llvm::dyn_cast<llvm::ConstantInt>(memberOffset);
+            if (!memberOffsetInt) {
+                std::lock_guard<std::mutex> guard(analysis.dbgsLock);
+                gep->print(llvm::dbgs());
+                llvm::dbgs() << "\n";
+                return NO_MEMBER;
+            }
 
-                    auto icmpinst = cast<ICmpInst>(&Inst);
-                    if (icmpinst->getPredicate() != CmpInst::ICMP_EQ &&
-                        icmpinst->getPredicate() != CmpInst::ICMP_NE) {
-                        continue;
-                    }
+            int64_t memberIndex = memberOffsetInt->getSExtValue();
+            auto [iter, inserted] = fieldMembers.try_emplace({structType, memberIndex}, NO_MEMBER);
+            if (!inserted) {
+                return iter->second;
+            }
 
-                    // find non-null branch, and that branch used the variable
-                    llvm::Value* var = icmpinst->getOperand(0);
-                    llvm::Value* immediate = icmpinst->getOperand(1);
-                    if (!isa<ConstantData>(immediate)) {
-                        std::swap(var, immediate);
-                    }
+            // get rid of leading `struct.`
+            llvm::StringRef parentTypeName = structType->getName();
+            parentTypeName.consume_front("struct.");
+            // literal structs have no name to report them by
+            if (parentTypeName.empty()) {
+                return NO_MEMBER;
+            }
 
-                    if (!isa<ConstantData>(immediate)) {
-                        // both are not immediate, not inject
-                        continue;
-                    }
+            auto& dataLayout = gep->getFunction()->getParent()->getDataLayout();
+            const llvm::StructLayout* structLayout = dataLayout.getStructLayout(structType);
+            iter->second = {analysis.internTypeName(parentTypeName),
+                            static_cast<int>(structLayout->getElementOffset(memberIndex))};
+            return iter->second;
+        }
+    };
 
-                    if ((isa<ConstantInt>(immediate) &&
-                         cast<ConstantInt>(immediate)->isZero()) ||
-                        isa<ConstantPointerNull>(immediate)) {
-                        // do nothing
-                    } else {
-                        continue;
+   private:
+    void analyzeModuleForNullCheckedMembers(const mfuzz::ModuleIndex& index,
+                                            std::vector<MemberKey>& checkedMembers) {
+        MemberDecoder decoder(*this);
+        for (const mfuzz::FunctionIndex& func : index.functions) {
+            for (const mfuzz::NullCompare& nullCompare : func.nullCompares) {
+                auto icmpinst = nullCompare.inst;
+                llvm::Value* var = nullCompare.var;
+                llvm::BasicBlock& BB = *icmpinst->getParent();
+
+                // find the branch (br i1)
+                bool branch_found = false;
+                llvm::BranchInst* brinst = nullptr;
+
+                auto curr_inst = icmpinst->getIterator();
+                while (true) {
+                    curr_inst++;
+                    if (curr_inst == BB.end()) {
+                        break;
                     }
 
-                    // find the branch (br i1)
-                    bool branch_found = false;
-                    llvm::BranchInst* brinst = nullptr;
-
-                    auto curr_inst = itinst;
-                    while (true) {
-                        curr_inst++;
-                        if (curr_inst == BB.end()) {
-                            break;
-                        }
-
-                        if (curr_inst->getOpcode() == Instruction::Br) {
-                            brinst = cast<BranchInst>(&*curr_inst);
-                            if (brinst->isConditional()) {
-                                if (brinst->getCondition() == icmpinst) {
-                                    branch_found = true;
-                                    break;
-                                }
+                    if (curr_inst->getOpcode() == Instruction::Br) {
+                        brinst = cast<BranchInst>(&*curr_inst);
+                        if (brinst->isConditional()) {
+                            if (brinst->getCondition() == icmpinst) {
+                                branch_found = true;
+                                break;
                             }
-                        } else {
-                            continue;
                         }
-                    }
-                    if (!branch_found) {
-                        continue;
-                    }
-
-                    // find the parent type info
-                    llvm::LoadInst* loadVarInst = dyn_cast<LoadInst>(var);
-                    if (!loadVarInst) {
-                        continue;
-                    }
-
-                    auto nullableMemberInfo =
-                        getNullableMemberInfo(loadVarInst);
-
-                    if (nullableMemberInfo.parentTypeName.empty()) {
+                    } else {
                         continue;
                     }
+                }
+                if (!branch_found) {
+                    continue;
+                }
 
-                    // store the result
-                    std::string memberInfo =
-                        nullableMemberInfo.parentTypeName + ":" +
-                        std::to_string(nullableMemberInfo.offset);
-                    checkNullMemberSet.insert(memberInfo);
+                // find the parent type info
+                llvm::LoadInst* loadVarInst = dyn_cast<LoadInst>(var);
+                if (!loadVarInst) {
+                    continue;
+                }
 
-                    // std::cout << "found null check: " << memberInfo << std::endl;
+                MemberKey member = decoder.decode(loadVarInst);
+                if (member == NO_MEMBER) {
+                    continue;
                 }
+
+                // store the result
+                checkedMembers.push_back(member);
             }
         }
     }
 
-    void analyzeModuleForNullableMembers(llvm::Module& M) {
-        for (auto& F : M) {
-            std::string funcName = mfuzz::getDefinedFuncName(&F);
-            int serial = 0;
-            if (funcName.empty())
-                continue;
-
-            for (auto& BB : F) {
-                for (auto& Ins : BB) {
-                    // find store null instruction
-                    llvm::StoreInst* storeIns =
-                        llvm::dyn_cast<llvm::StoreInst>(&Ins);
-                    if (!storeIns)
-                        continue;
-
-                    llvm::Value* storeValue = storeIns->getValueOperand();
-                    if (!storeValue)
-                        continue;
-
-                    if ((isa<ConstantInt>(storeValue) &&
-                         cast<ConstantInt>(storeValue)->isZero()) ||
-                        isa<ConstantPointerNull>(storeValue)) {
-                        // do nothing
-                    } else {
-                        continue;
-                    }
-
-                    // find the parent type info
-                    auto simpleNullableMemberInfo = getNullableMemberInfo(storeIns);
-
-                    if (simpleNullableMemberInfo.parentTypeName.empty()) {
-                        continue;
-                    }
-
-                    std::string memberInfo =
-                        simpleNullableMemberInfo.parentTypeName + ":" +
-                        std::to_string(simpleNullableMemberInfo.offset);
-
-                    if (checkNullMemberSet.count(memberInfo) == 0) {
-                        continue;
-                    }
+    void analyzeModuleForNullableMembers(const mfuzz::ModuleIndex& index,
+                                         std::vector<mfuzz::NullableMemberInfo>& nullableMembers) {
+        MemberDecoder decoder(*this);
+        for (const mfuzz::FunctionIndex& func : index.functions) {
+            // stores of null are found by the index
+            for (llvm::StoreInst* storeIns : func.nullStores) {
+                // find the parent type info
+                MemberKey member = decoder.decode(storeIns);
+                if (member == NO_MEMBER || checkNullMemberSet.count(member) == 0) {
+                    continue;
+                }
 
-                    mfuzz::NullableMemberInfo nullableMemberInfo;
+                mfuzz::NullableMemberInfo nullableMemberInfo;
 
-                    nullableMemberInfo.parentTypeName =
-                        simpleNullableMemberInfo.parentTypeName;
-                    nullableMemberInfo.offset =
-                        simpleNullableMemberInfo.offset;
+                nullableMemberInfo.parentTypeName = getTypeName(member.first);
+                nullableMemberInfo.offset = member.second;
 
-                    // fill location information
-                    nullableMemberInfo.setLocationInfo(*storeIns);
+                // fill location information
+                nullableMemberInfo.setLocationInfo(*storeIns);
 
-                    // store the result
-                    nullableMemberVector.push_back(nullableMemberInfo);
-                }
+                // store the result
+                nullableMembers.push_back(nullableMemberInfo);
             }
         }
     }
-};
\ No newline at end of file
+};
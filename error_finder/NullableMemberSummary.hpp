@@ -0,0 +1,48 @@
+#ifndef ANALYZER_NULLABLEMEMBERSUMMARY_HPP
+#define ANALYZER_NULLABLEMEMBERSUMMARY_HPP
+
+#include "fault_point_info.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// What the nullable member analysis needs to know about one module: the
+// members it compares against null, and every store of null to a member.
+// Which of those stores are reported depends on the members checked in
+// all modules, so that is decided when merging.
+struct NullableModuleSummary {
+    std::vector<std::pair<std::string, int>> checkedMembers;  // (struct type, offset)
+    std::vector<mfuzz::NullableMemberInfo> nullStores;        // without source code
+
+    void fill_ptree(ptree& pt) {
+        ptree members;
+        for (auto& [parentTypeName, offset] : checkedMembers) {
+            ptree member;
+            member.put("parentTypeName", parentTypeName);
+            member.put("offset", offset);
+            members.push_back(std::make_pair("", member));
+        }
+        pt.add_child("checkedMembers", members);
+
+        ptree stores;
+        for (mfuzz::NullableMemberInfo& store : nullStores) {
+            ptree child;
+            store.fill_ptree(child);
+            stores.push_back(std::make_pair("", child));
+        }
+        pt.add_child("nullStores", stores);
+    }
+
+    void extract_ptree(ptree& pt) {
+        for (auto& item : pt.get_child("checkedMembers")) {
+            checkedMembers.emplace_back(item.second.get<std::string>("parentTypeName"),
+                                        item.second.get<int>("offset"));
+        }
+        for (auto& item : pt.get_child("nullStores")) {
+            nullStores.emplace_back().extract_ptree(item.second);
+        }
+    }
+};
+
+#endif
@@ -1,111 +1,121 @@
 #include "alias_flow_insensitive.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #define LOAD_ID		99990
 #define GEP_ID		99991
 using namespace std;
 
-static void CreateValueVN(Value *val, 
-					map<Value *, ValueNode *> &vn_index,
-					set<ValueNode *> &vn_set) {
-	ValueNode *vn = new ValueNode;
-	vn_set.insert(vn);
-	vn->aliases.insert(val);
-	vn_index[val] = vn;
-}
+const unsigned AliasGraph::NO_NODE;
 
-static void HandleValueAlloca(Instruction *inst, 
-					map<Value *, ValueNode *> &vn_index,
-					set<ValueNode *> &vn_set) {
-	CreateValueVN(inst, vn_index, vn_set);
+unsigned AliasGraph::CreateNode(Value *val) {
+	unsigned node = alias_head.size();
+	alias_head.push_back(NO_NODE);
+	AddAlias(node, val);
+	vn_index[val] = node;
+	return node;
 }
 
-static void HandleValueLoad(Instruction *inst, 
-					map<Value *, ValueNode *> &vn_index,
-					set<ValueNode *> &vn_set) {
-	Value *val = inst->getOperand(0);
-	Value *ret_val = inst;
-	map<Value *, ValueNode *>::iterator vn_it = vn_index.find(val);
-	if (vn_it == vn_index.end()) {
-		CreateValueVN(val, vn_index, vn_set);
-	}
-	ValueNode *vn = vn_index[val];
-	ValueNode *ret_vn = NULL;
-	if (vn->succ.find(LOAD_ID) != vn->succ.end()) {
-		ret_vn = vn->succ[LOAD_ID];
-		vn_index[ret_val] = ret_vn;
-		ret_vn->aliases.insert(ret_val);
-	}
-	else {
-		CreateValueVN(ret_val, vn_index, vn_set);
-		ret_vn = vn_index[ret_val];
-		vn->succ[LOAD_ID] = ret_vn;
+unsigned AliasGraph::GetOrCreateNode(Value *val) {
+	unsigned node = GetNode(val);
+	if (node == NO_NODE) {
+		node = CreateNode(val);
 	}
+	return node;
 }
 
-static void HandleValueStore(Instruction *inst, 
-					map<Value *, ValueNode *> &vn_index,
-					set<ValueNode *> &vn_set) {
-	Value *val = inst->getOperand(1);
-	Value *ret_val = inst->getOperand(0);
-	if (vn_index.find(val) == vn_index.end()) {
-		CreateValueVN(val, vn_index, vn_set);
-	}
-	if (vn_index.find(ret_val) == vn_index.end()) {
-		CreateValueVN(ret_val, vn_index, vn_set);
-	}
-	ValueNode *vn = vn_index[val];
-	ValueNode *ret_vn = vn_index[ret_val];
-	vn->succ[LOAD_ID] = ret_vn;
+void AliasGraph::AddAlias(unsigned node, Value *val) {
+	AliasEntry entry = {val, alias_head[node]};
+	alias_head[node] = aliases.size();
+	aliases.push_back(entry);
 }
 
-static void HandleValueGEP(Instruction *inst, 
-					map<Value *, ValueNode *> &vn_index,
-					set<ValueNode *> &vn_set) {
-	Value *val = inst->getOperand(0);
-	Value *ret_val = inst;
-	map<Value *, ValueNode *>::iterator vn_it = vn_index.find(val);
-	if (vn_it == vn_index.end()) {
-		CreateValueVN(val, vn_index, vn_set);
-	}
-	ValueNode *vn = vn_index[val];
-	ValueNode *ret_vn = NULL;
-	int index = GEP_ID;
-	Value *index_val = inst->getOperand(inst->getNumOperands() - 1);
-	if (ConstantInt *const_int = dyn_cast<ConstantInt>(index_val)) {
-		if (const_int->getBitWidth() <= 64) {
-			index = const_int->getSExtValue();
-		}
-	}
-	if (vn->succ.find(index) != vn->succ.end()) {
-		ret_vn = vn->succ[index];
+// ret_val is what val points to, reached through edge
+void AliasGraph::HandleDeref(Value *val, Value *ret_val, long edge) {
+	unsigned vn = GetOrCreateNode(val);
+	DenseMap<pair<unsigned, long>, unsigned>::iterator succ_it =
+		succ.find(make_pair(vn, edge));
+	if (succ_it != succ.end()) {
+		unsigned ret_vn = succ_it->second;
 		vn_index[ret_val] = ret_vn;
-		ret_vn->aliases.insert(ret_val);
+		AddAlias(ret_vn, ret_val);
 	}
 	else {
-		CreateValueVN(ret_val, vn_index, vn_set);
-		ret_vn = vn_index[ret_val];
-		vn->succ[index] = ret_vn;
+		// ret_val may already have a node if it was used before this
+		// point; like any definition, it starts a new one
+		unsigned ret_vn = CreateNode(ret_val);
+		succ[make_pair(vn, edge)] = ret_vn;
 	}
 }
 
-static void HandleValueBitCast(Instruction *inst, 
-					map<Value *, ValueNode *> &vn_index,
-					set<ValueNode *> &vn_set) {
-	Value *val = inst->getOperand(0);
-	Value *ret_val = inst;
-	map<Value *, ValueNode *>::iterator vn_it = vn_index.find(val);
-	if (vn_it == vn_index.end()) {
-		CreateValueVN(val, vn_index, vn_set);
+void AliasGraph::AddInst(Instruction *inst) {
+	switch (inst->getOpcode()) {
+		case Instruction::Alloca :
+			CreateNode(inst);
+			break;
+		case Instruction::Load :
+			HandleDeref(inst->getOperand(0), inst, LOAD_ID);
+			break;
+		case Instruction::Store : {
+			Value *val = inst->getOperand(1);
+			Value *ret_val = inst->getOperand(0);
+			unsigned vn = GetOrCreateNode(val);
+			unsigned ret_vn = GetOrCreateNode(ret_val);
+			succ[make_pair(vn, (long)LOAD_ID)] = ret_vn;
+			break;
+		}
+		case Instruction::GetElementPtr : {
+			int index = GEP_ID;
+			Value *index_val = inst->getOperand(inst->getNumOperands() - 1);
+			if (ConstantInt *const_int = dyn_cast<ConstantInt>(index_val)) {
+				if (const_int->getBitWidth() <= 64) {
+					index = const_int->getSExtValue();
+				}
+			}
+			HandleDeref(inst->getOperand(0), inst, index);
+			break;
+		}
+		case Instruction::Trunc :
+		case Instruction::ZExt :
+		case Instruction::SExt :
+		case Instruction::PtrToInt :
+		case Instruction::IntToPtr :
+		case Instruction::FPTrunc :
+		case Instruction::FPExt :
+		case Instruction::FPToUI :
+		case Instruction::FPToSI :
+		case Instruction::UIToFP :
+		case Instruction::SIToFP :
+		case Instruction::BitCast : {
+			// a cast is one more name for its operand's node
+			unsigned vn = GetOrCreateNode(inst->getOperand(0));
+			AddAlias(vn, inst);
+			vn_index[inst] = vn;
+			break;
+		}
+		default :
+			break;
 	}
-	ValueNode *vn = vn_index[val];
-	vn->aliases.insert(ret_val);
-	vn_index[ret_val] = vn;
 }
 
-bool GetAliasValueInsensitive(Value *val, Instruction *begin_inst, 
+static bool GetAliases(const AliasGraph &graph, Value *val,
+					vector<Value *> &alias_val_vec) {
+	alias_val_vec.push_back(val);
+	unsigned vn = graph.GetNode(val);
+	if (vn == AliasGraph::NO_NODE) {
+		return false;
+	}
+	SmallPtrSet<Value *, 16> seen;
+	seen.insert(val);
+	graph.ForEachAlias(vn, [&](Value *alias_val) {
+		if (seen.insert(alias_val).second) {
+			alias_val_vec.push_back(alias_val);
+		}
+	});
+	return true;
+}
+
+bool GetAliasValueInsensitive(Value *val, Instruction *begin_inst,
 					Instruction *end_inst, vector<Value *> &alias_val_vec) {
-	map<Value *, set<Value *> > val_index;
-	map<Value *, ValueNode *> vn_index;
-	set<ValueNode *> vn_set;
+	AliasGraph graph;
 	Function *func = begin_inst->getFunction();
 	begin_inst = begin_inst->getNextNode();
 	bool flag = false;
@@ -134,133 +144,68 @@ bool GetAliasValueInsensitive(Value *val, Instruction *begin_inst,
 				goon = false;
 				break;
 			}
-			switch (inst->getOpcode()) {
-				case Instruction::Alloca :
-					HandleValueAlloca(inst, vn_index, vn_set);
-					break;
-				case Instruction::Load :
-					HandleValueLoad(inst, vn_index, vn_set);
-					break;
-				case Instruction::Store :
-					HandleValueStore(inst, vn_index, vn_set);
-					break;
-				case Instruction::GetElementPtr :
-					HandleValueGEP(inst, vn_index, vn_set);
-					break;
-				case Instruction::Trunc :
-				case Instruction::ZExt :
-				case Instruction::SExt :
-				case Instruction::PtrToInt :
-				case Instruction::IntToPtr :
-				case Instruction::FPTrunc :
-				case Instruction::FPExt :
-				case Instruction::FPToUI :
-				case Instruction::FPToSI :
-				case Instruction::UIToFP :
-				case Instruction::SIToFP :
-				case Instruction::BitCast :
-					HandleValueBitCast(inst, vn_index, vn_set);
-					break;
-				default :
-					break;
-			}
+			graph.AddInst(inst);
 		}
 	}
 
-	bool found = false;
-
-	alias_val_vec.push_back(val);
-	if (vn_index.find(val) != vn_index.end()) {
-		found = true;
-		ValueNode *vn = vn_index[val];
-		set<Value *>::iterator ali_it, ali_end;
-		ali_it = vn->aliases.begin();
-		ali_end = vn->aliases.end();
-		for (; ali_it != ali_end; ali_it++) {
-			if (*ali_it != val) {
-				alias_val_vec.push_back(*ali_it);
-			}
-		}
-	}
-	set<ValueNode *>::iterator vn_it, vn_end;
-	vn_it = vn_set.begin();
-	vn_end = vn_set.end();
-	for (; vn_it != vn_end; vn_it++) {
-		delete *vn_it;
-	}
-	return found;
+	return GetAliases(graph, val, alias_val_vec);
 }
 
-bool GetAliasValueInsensitive(Value *val, Function* func, vector<Value *> &alias_val_vec) {
-	map<Value *, set<Value *> > val_index;
-	map<Value *, ValueNode *> vn_index;
-	set<ValueNode *> vn_set;
-
+FunctionAliasIndex::FunctionAliasIndex(Function *func) {
 	Function::iterator f_it, f_end;
 	f_it = func->begin();
 	f_end = func->end();
 	for (; f_it != f_end; f_it++) {
-
 		BasicBlock *block = &(*f_it);
 		BasicBlock::iterator b_it, b_end;
 		b_it = block->begin();
 		b_end = block->end();
 		for (; b_it != b_end; b_it++) {
-			Instruction *inst = &(*b_it);
-
-			switch (inst->getOpcode()) {
-				case Instruction::Alloca :
-					HandleValueAlloca(inst, vn_index, vn_set);
-					break;
-				case Instruction::Load :
-					HandleValueLoad(inst, vn_index, vn_set);
-					break;
-				case Instruction::Store :
-					HandleValueStore(inst, vn_index, vn_set);
-					break;
-				case Instruction::GetElementPtr :
-					HandleValueGEP(inst, vn_index, vn_set);
-					break;
-				case Instruction::Trunc :
-				case Instruction::ZExt :
-				case Instruction::SExt :
-				case Instruction::PtrToInt :
-				case Instruction::IntToPtr :
-				case Instruction::FPTrunc :
-				case Instruction::FPExt :
-				case Instruction::FPToUI :
-				case Instruction::FPToSI :
-				case Instruction::UIToFP :
-				case Instruction::SIToFP :
-				case Instruction::BitCast :
-					HandleValueBitCast(inst, vn_index, vn_set);
-					break;
-				default :
-					break;
-			}
+			graph.AddInst(&(*b_it));
 		}
 	}
+}
 
-	bool found = false;
+bool FunctionAliasIndex::GetAliases(Value *val, vector<Value *> &alias_val_vec) const {
+	return ::GetAliases(graph, val, alias_val_vec);
+}
 
-	alias_val_vec.push_back(val);
-	if (vn_index.find(val) != vn_index.end()) {
-		found = true;
-		ValueNode *vn = vn_index[val];
-		set<Value *>::iterator ali_it, ali_end;
-		ali_it = vn->aliases.begin();
-		ali_end = vn->aliases.end();
-		for (; ali_it != ali_end; ali_it++) {
-			if (*ali_it != val) {
-				alias_val_vec.push_back(*ali_it);
+bool FunctionAliasIndex::IsAliasUsedBy(Value *val, const void *query,
+					bool (*is_user)(User *)) {
+	unsigned vn = graph.GetNode(val);
+	if (vn == AliasGraph::NO_NODE) {
+		// a value outside the graph is its only alias
+		for (User *user : val->users()) {
+			if (is_user(user)) {
+				return true;
 			}
 		}
+		return false;
 	}
-	set<ValueNode *>::iterator vn_it, vn_end;
-	vn_it = vn_set.begin();
-	vn_end = vn_set.end();
-	for (; vn_it != vn_end; vn_it++) {
-		delete *vn_it;
-	}
-	return found;
+
+	// every value of a node has the same aliases, so answer once per node
+	pair<unsigned, const void *> key(vn, query);
+	DenseMap<pair<unsigned, const void *>, bool>::iterator used_it = used_by.find(key);
+	if (used_it != used_by.end()) {
+		return used_it->second;
+	}
+	bool used = false;
+	graph.ForEachAlias(vn, [&](Value *alias_val) {
+		if (used) {
+			return;
+		}
+		for (User *user : alias_val->users()) {
+			if (is_user(user)) {
+				used = true;
+				break;
+			}
+		}
+	});
+	used_by[key] = used;
+	return used;
+}
+
+bool GetAliasValueInsensitive(Value *val, Function* func, vector<Value *> &alias_val_vec) {
+	FunctionAliasIndex alias_index(func);
+	return alias_index.GetAliases(val, alias_val_vec);
 }
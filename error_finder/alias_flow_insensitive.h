@@ -4,6 +4,7 @@
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/ADT/DenseMap.h"
 
 #include <map>
 #include <vector>
@@ -13,15 +14,74 @@
 using namespace llvm;
 using namespace std;
 
-typedef struct ValueNode {
-	map<long, struct ValueNode *> succ;
-	set<ValueNode *> pres;
-	set<Value *> aliases;
-} ValueNode;
+// Flow-insensitive alias graph of the instructions added to it. A node
+// stands for the values that alias each other; an edge leads from a
+// pointer to what a load or a GEP with a given index yields.
+//
+// Nodes are indices into flat arrays of trivially destructible entries, so
+// adding a node or an alias is a push_back and the graph is freed in a
+// handful of deallocations, whatever its size.
+class AliasGraph {
+public:
+	static const unsigned NO_NODE = ~0u;
+
+	void AddInst(Instruction *inst);
+
+	// the node val was last put into, or NO_NODE
+	unsigned GetNode(Value *val) const {
+		DenseMap<Value *, unsigned>::const_iterator vn_it = vn_index.find(val);
+		return vn_it == vn_index.end() ? NO_NODE : vn_it->second;
+	}
+
+	// calls fn on the values of node; a value may be passed more than once
+	template <typename Fn>
+	void ForEachAlias(unsigned node, Fn fn) const {
+		for (unsigned entry = alias_head[node]; entry != NO_NODE;
+				entry = aliases[entry].next) {
+			fn(aliases[entry].val);
+		}
+	}
+
+private:
+	struct AliasEntry {
+		Value *val;
+		unsigned next;
+	};
+
+	unsigned CreateNode(Value *val);
+	unsigned GetOrCreateNode(Value *val);
+	void AddAlias(unsigned node, Value *val);
+	void HandleDeref(Value *val, Value *ret_val, long edge);
+
+	vector<unsigned> alias_head;		// per node, its last alias entry
+	vector<AliasEntry> aliases;
+	DenseMap<Value *, unsigned> vn_index;
+	DenseMap<pair<unsigned, long>, unsigned> succ;
+};
+
+// The alias graph of a whole function, built once and queried for any
+// number of values. GetAliasValueInsensitive(val, func) rebuilds it on
+// every call.
+class FunctionAliasIndex {
+public:
+	explicit FunctionAliasIndex(Function *func);
+	FunctionAliasIndex(const FunctionAliasIndex &) = delete;
+	FunctionAliasIndex &operator=(const FunctionAliasIndex &) = delete;
+
+	// val followed by its aliases; false if val is not in the graph
+	bool GetAliases(Value *val, vector<Value *> &alias_val_vec) const;
+	// whether is_user holds for a user of val or of one of its aliases;
+	// answers are memoized per alias set and query
+	bool IsAliasUsedBy(Value *val, const void *query, bool (*is_user)(User *));
+
+private:
+	AliasGraph graph;
+	DenseMap<pair<unsigned, const void *>, bool> used_by;
+};
 
 bool GetAliasValueInsensitive(Value *val, Instruction *begin_inst,
 					Instruction *end_inst, vector<Value *> &alias_val_vec);
-bool GetAliasValueInsensitive(Value *val, 
+bool GetAliasValueInsensitive(Value *val,
 					Function* func, vector<Value *> &alias_val_vec);
 
 #endif
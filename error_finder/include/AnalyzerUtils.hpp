@@ -19,6 +19,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/Pass.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/Casting.h"
@@ -37,6 +38,8 @@ std::vector<std::string> getAllFileNameInDir(const std::string& dirName) {
             fileNames.push_back(p.path());
         }
     }
+    // directory order is unspecified; keep runs reproducible
+    std::sort(fileNames.begin(), fileNames.end());
     return fileNames;
 }
 
@@ -60,6 +63,37 @@ llvm::Function* getCalledFunc(llvm::Instruction* InsPtr) {
     return calledfunc;
 }
 
+// Reads the body of a function of a lazily loaded module; a no-op for
+// modules parsed up front.
+bool materialize(llvm::Function& F) {
+    if (!F.isMaterializable())
+        return true;
+    if (llvm::Error err = F.materialize()) {
+        llvm::errs() << "Error materializing " << F.getName() << ": "
+                     << llvm::toString(std::move(err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Loads fileName with getLazyIRFileModule into a context of its own and
+// hands it to visit. Function bodies are only read once materialized, and
+// everything is freed when visit returns.
+template <typename Visitor>
+bool visitLazyModule(const std::string& fileName, Visitor visit) {
+    llvm::LLVMContext ctx;
+    llvm::SMDiagnostic err;
+    std::unique_ptr<llvm::Module> modulePtr =
+        llvm::getLazyIRFileModule(fileName, err, ctx);
+    if (!modulePtr) {
+        llvm::errs() << "Error reading bitcode file: " << fileName << ": "
+                     << err.getMessage() << "\n";
+        return false;
+    }
+    visit(*modulePtr);
+    return true;
+}
+
 bool isRetPointerOrInt(llvm::Function* funcPtr) {
     return funcPtr && (funcPtr->getReturnType()->isIntegerTy() || funcPtr->getReturnType()->isPointerTy());
 }
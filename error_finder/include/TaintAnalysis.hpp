@@ -1,7 +1,11 @@
 #ifndef INCLUDE_TAINT_ANALYSIS_HPP__
 #define INCLUDE_TAINT_ANALYSIS_HPP__
 
+#include <deque>
+
 #include "AnalyzerUtils.hpp"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/IR/CFG.h"
 
 // check if the return value of called func is checked after the call
 // instruction
@@ -58,4 +62,157 @@ class TaintSet {
     std::set<Taint> set;
 };
 
-#endif
\ No newline at end of file
+// Forward may-taint dataflow over the CFG of one function. Every value of
+// the function gets a bit, the state entering a block is the union of what
+// its predecessors hand on, and a block is revisited only when that state
+// grows, so a query takes linear time in the blocks times the values
+// instead of one walk per path. Build once per function and query it for
+// any number of starting points.
+class TaintDataflow {
+   public:
+    explicit TaintDataflow(llvm::Function& func) {
+        for (auto& BB : func) {
+            blockIds.try_emplace(&BB, blockIds.size());
+            for (auto& ins : BB) {
+                number(&ins);
+                for (llvm::Value* operand : ins.operands())
+                    number(operand);
+            }
+        }
+    }
+
+    bool isTainted(const llvm::BitVector& state, const Taint& taint) const {
+        auto iter = ids.find(taint.p);
+        return iter != ids.end() && state.test(iter->second);
+    }
+
+    // Whether sink(ins, state) holds for an instruction reached from the
+    // one after start, with the seeds tainted at start
+    template <typename Sink>
+    bool reaches(llvm::Instruction* start, const TaintSet& seeds, Sink sink) {
+        std::vector<llvm::BitVector> entryStates(blockIds.size());
+        std::vector<bool> reached(blockIds.size(), false);
+        std::vector<bool> queued(blockIds.size(), false);
+        std::deque<llvm::BasicBlock*> worklist;
+
+        llvm::BitVector state(ids.size());
+        for (const Taint& taint : seeds.set)
+            insert(state, taint);
+
+        // the rest of the starting block; it is walked from its top if a
+        // path comes back to it
+        if (transfer(start->getNextNode(), state, sink))
+            return true;
+        flowToSuccessors(start->getParent(), state, entryStates, reached, queued, worklist);
+
+        while (!worklist.empty()) {
+            llvm::BasicBlock* BB = worklist.front();
+            worklist.pop_front();
+            unsigned id = blockIds[BB];
+            queued[id] = false;
+
+            state = entryStates[id];
+            if (transfer(&*BB->begin(), state, sink))
+                return true;
+            flowToSuccessors(BB, state, entryStates, reached, queued, worklist);
+        }
+        return false;
+    }
+
+   private:
+    llvm::DenseMap<llvm::Value*, unsigned> ids;
+    llvm::DenseMap<llvm::BasicBlock*, unsigned> blockIds;
+    // what storing a tainted value to an address taints, by address
+    llvm::DenseMap<llvm::Value*, llvm::BitVector> storeTargets;
+
+    void number(llvm::Value* val) {
+        if (llvm::isa<llvm::BasicBlock>(val) ||
+            (llvm::isa<llvm::Constant>(val) && !llvm::isa<llvm::GlobalValue>(val)))
+            return;
+        ids.try_emplace(val, ids.size());
+    }
+
+    void insert(llvm::BitVector& state, const Taint& taint) const {
+        auto iter = ids.find(taint.p);
+        if (iter != ids.end())
+            state.set(iter->second);
+    }
+
+    void remove(llvm::BitVector& state, const Taint& taint) const {
+        auto iter = ids.find(taint.p);
+        if (iter != ids.end())
+            state.reset(iter->second);
+    }
+
+    const llvm::BitVector& getStoreTargets(llvm::Value* pointer) {
+        auto iter = storeTargets.find(pointer);
+        if (iter != storeTargets.end())
+            return iter->second;
+        TaintSet targets;
+        targets.insertBackToGetElement(pointer);
+        llvm::BitVector bits(ids.size());
+        for (const Taint& taint : targets.set)
+            insert(bits, taint);
+        return storeTargets[pointer] = std::move(bits);
+    }
+
+    // runs ins and what follows it in its block on state
+    template <typename Sink>
+    bool transfer(llvm::Instruction* ins, llvm::BitVector& state, Sink& sink) {
+        using namespace llvm;
+        for (; ins; ins = ins->getNextNode()) {
+            if (ins->isCast()) {
+                if (isTainted(state, ins->getOperand(0)))
+                    insert(state, ins);
+                continue;
+            }
+            if (sink(*ins, state))
+                return true;
+            switch (ins->getOpcode()) {
+                case Instruction::Store: {
+                    Value* operand1 = ins->getOperand(0);
+                    Value* operand2 = ins->getOperand(1);
+                    if (isTainted(state, operand1))
+                        state |= getStoreTargets(operand2);
+                    else
+                        remove(state, operand2);
+                    break;
+                }
+                case Instruction::Load:
+                case Instruction::GetElementPtr:
+                    // Taint does not tell offsets apart
+                    if (isTainted(state, ins->getOperand(0)))
+                        insert(state, ins);
+                    break;
+                default:
+                    break;
+            }
+        }
+        return false;
+    }
+
+    void flowToSuccessors(llvm::BasicBlock* BB, const llvm::BitVector& state,
+                          std::vector<llvm::BitVector>& entryStates, std::vector<bool>& reached,
+                          std::vector<bool>& queued, std::deque<llvm::BasicBlock*>& worklist) {
+        for (llvm::BasicBlock* succ : llvm::successors(BB)) {
+            unsigned id = blockIds[succ];
+            llvm::BitVector& entry = entryStates[id];
+            if (!reached[id]) {
+                reached[id] = true;
+                entry = state;
+            } else {
+                llvm::BitVector merged = entry;
+                merged |= state;
+                if (merged == entry)
+                    continue;
+                entry = std::move(merged);
+            }
+            if (!queued[id]) {
+                queued[id] = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+};
+
+#endif
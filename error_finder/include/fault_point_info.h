@@ -4,6 +4,8 @@
 #include <string>
 #include <sstream> 
 #include "commonutils.hpp"
+#include "result_stream.h"
+#include "source_line_cache.h"
 
 
 #include <map>
@@ -58,7 +60,8 @@ struct InstructionLocationInfo {
 
     //ptree pt;
 
-    void setLocationInfo(llvm::Instruction& inst) {
+    void setLocationInfo(llvm::Instruction& inst,
+                         bool withSourceCode = outputSourceCode) {
         llvm::Function& func = *inst.getFunction();
 
         functionName = func.getName();
@@ -78,34 +81,44 @@ struct InstructionLocationInfo {
             lineNumber = calleeInlinedLocation->getLine();
         }
 
-        if (outputSourceCode) {
-            std::filesystem::path sourceFilePath = modulePath / fileName;
+        if (withSourceCode)
+            loadSourceCode();
+    }
 
-            std::ifstream sourceFile(modulePath / fileName);
-            int i = 0;
-            for (; sourceFile.good() && i < lineNumber; i++) {
-                std::getline(sourceFile, sourceCode);
-            }
+    // reads the statement at lineNumber of fileName under modulePath
+    void loadSourceCode() {
+        // files are mapped once and indexed by line, but read here as a
+        // std::getline loop from the start of the file would read them
+        const SourceFile* sourceFile =
+            SourceLineCache::instance().get((modulePath / fileName).string());
+        bool good = sourceFile != nullptr;
+        int i = 0;
+        llvm::StringRef line;
+        if (good && lineNumber > 0) {
+            // such a loop stops early at the line that ends the file
+            i = std::min<size_t>(lineNumber, sourceFile->terminatedLineCount() + 1);
+            good = sourceFile->getLine(i, line);
+            sourceCode = line.str();
+        }
 
-            std::string thisLine = sourceCode;
-            int max_lines = 10;
-            int count = 0;
-            while (sourceFile.good() && thisLine.find(';')==std::string::npos) {
-                std::getline(sourceFile, thisLine);
-                i++;
-                sourceCode += " ";
-                sourceCode += thisLine;
-                count++;
-                if (count > max_lines) {
-                    break;
-                }
+        std::string thisLine = sourceCode;
+        int max_lines = 10;
+        int count = 0;
+        while (good && thisLine.find(';')==std::string::npos) {
+            good = sourceFile->getLine(i + 1, line);
+            thisLine = line.str();
+            i++;
+            sourceCode += " ";
+            sourceCode += thisLine;
+            count++;
+            if (count > max_lines) {
+                break;
             }
-            replace(sourceCode, "\t", " ");
-            trim(sourceCode);
-            if(i < lineNumber)
-                sourceCode = InstructionLocationInfo::DEFAULT_SOURCECODE;
         }
-        
+        replace(sourceCode, "\t", " ");
+        trim(sourceCode);
+        if(i < lineNumber)
+            sourceCode = InstructionLocationInfo::DEFAULT_SOURCECODE;
     }
 
     void fill_ptree(ptree &pt){
@@ -124,36 +137,47 @@ struct InstructionLocationInfo {
         sourceCode   = pt.get<std::string>("sourceCode");
     }
 
+    // reads JSON or binary results, one record at a time
     template<typename T>
     static void input_vector(std::istream &is, std::vector<T> &vec){
-        ptree final_ptree;
-
-        read_json(is, final_ptree);
+        if (BinaryResultReader::isBinary(is)) {
+            BinaryResultReader reader(is);
+            read_records(reader, vec);
+        } else {
+            JsonResultReader reader(is);
+            read_records(reader, vec);
+        }
+    }
 
-        ptree children = final_ptree.get_child("info");
+    template<typename T>
+    static void output_vector(std::ostream &os, std::vector<T> &vec, bool binary = false){
+        if (binary) {
+            BinaryResultWriter writer(os);
+            write_records(writer, vec);
+        } else {
+            JsonResultWriter writer(os);
+            write_records(writer, vec);
+        }
+    }
 
-        for (auto& item : children.get_child("")) {
+    template<typename Reader, typename T>
+    static void read_records(Reader &reader, std::vector<T> &vec){
+        ptree pt;
+        while (reader.read(pt)) {
             T temp;
-            temp.extract_ptree(item.second);
+            temp.extract_ptree(pt);
             vec.emplace_back(std::move(temp));
         }
-
     }
 
-    template<typename T>
-    static void output_vector(std::ostream &os, std::vector<T> &vec){
-        ptree final_ptree;
-        ptree children;
+    template<typename Writer, typename T>
+    static void write_records(Writer &writer, std::vector<T> &vec){
         for (T& info : vec) {
             ptree pt;
             info.fill_ptree(pt);
-
-            children.push_back(std::make_pair("", pt));
+            writer.write(pt);
         }
-
-        final_ptree.add_child("info", children);
-
-        write_json(os, final_ptree, true);
+        writer.finish();
     }
 
 };
@@ -0,0 +1,93 @@
+#ifndef MODULE_INDEX_H
+#define MODULE_INDEX_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AnalyzerUtils.hpp"
+#include "llvm/IR/Instructions.h"
+
+namespace mfuzz {
+
+bool isZeroOrNull(llvm::Value* val) {
+    return (llvm::isa<llvm::ConstantInt>(val) && llvm::cast<llvm::ConstantInt>(val)->isZero()) ||
+           llvm::isa<llvm::ConstantPointerNull>(val);
+}
+
+// A direct call, with a debug location, to a function returning an int or
+// a pointer
+struct IndexedCall {
+    llvm::CallInst* inst;
+    llvm::Function* callee;
+};
+
+// An eq/ne compare, with a debug location, of var against 0 or NULL
+struct NullCompare {
+    llvm::ICmpInst* inst;
+    llvm::Value* var;
+};
+
+// The instructions of a function with a body that the analyses look at,
+// in program order
+struct FunctionIndex {
+    llvm::Function* function;
+    std::string name;
+    std::vector<IndexedCall> calls;
+    std::vector<NullCompare> nullCompares;
+    std::vector<llvm::StoreInst*> nullStores;  // of 0 or NULL, with TBAA metadata
+};
+
+// What all analyses need from a module, collected in one walk over its
+// instructions. The functions of a lazily loaded module are materialized
+// on the way. Holds pointers into the module, so must not outlive it.
+class ModuleIndex {
+   public:
+    std::vector<FunctionIndex> functions;  // those with a body, in module order
+    uint64_t callInstCount = 0;            // of all call instructions
+
+    ModuleIndex() = default;
+
+    explicit ModuleIndex(llvm::Module& M) {
+        for (auto& F : M) {
+            if (!materialize(F))
+                continue;
+            std::string funcName = getDefinedFuncName(&F);
+            if (funcName.empty())
+                continue;
+
+            FunctionIndex& func = functions.emplace_back();
+            func.function = &F;
+            func.name = std::move(funcName);
+            for (auto& BB : F) {
+                for (auto& ins : BB)
+                    addInstruction(func, ins);
+            }
+        }
+    }
+
+   private:
+    void addInstruction(FunctionIndex& func, llvm::Instruction& ins) {
+        if (auto* callInst = llvm::dyn_cast<llvm::CallInst>(&ins)) {
+            callInstCount++;
+            llvm::Function* callee = getCalledFunc(callInst);
+            if (isRetPointerOrInt(callee) && ins.getDebugLoc())
+                func.calls.push_back({callInst, callee});
+        } else if (auto* icmpInst = llvm::dyn_cast<llvm::ICmpInst>(&ins)) {
+            if (!ins.getDebugLoc() || !icmpInst->isEquality())
+                return;
+            llvm::Value* var = icmpInst->getOperand(0);
+            llvm::Value* immediate = icmpInst->getOperand(1);
+            if (!llvm::isa<llvm::ConstantData>(immediate))
+                std::swap(var, immediate);
+            if (isZeroOrNull(immediate))
+                func.nullCompares.push_back({icmpInst, var});
+        } else if (auto* storeInst = llvm::dyn_cast<llvm::StoreInst>(&ins)) {
+            if (isZeroOrNull(storeInst->getValueOperand()) &&
+                ins.getMetadata(llvm::LLVMContext::MD_tbaa))
+                func.nullStores.push_back(storeInst);
+        }
+    }
+};
+
+}  // namespace mfuzz
+#endif
@@ -0,0 +1,251 @@
+#ifndef RESULT_STREAM_H
+#define RESULT_STREAM_H
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+// Readers and writers of analysis results ({"info": [record, ...]}) that
+// hold one record at a time. A record is the ptree its fill_ptree makes.
+
+namespace mfuzz {
+
+// Lays records out exactly as write_json(os, {"info": [...]}, true) does,
+// except that no records give "info": [] rather than "".
+class JsonResultWriter {
+    std::ostream& os;
+    bool empty = true;
+
+   public:
+    explicit JsonResultWriter(std::ostream& os) : os(os) {
+        os << "{\n    \"info\": [";
+    }
+
+    void write(const boost::property_tree::ptree& pt) {
+        // a record on its own, moved two levels in; JSON escapes the
+        // newlines of strings, so every newline starts a line
+        std::ostringstream record;
+        boost::property_tree::write_json(record, pt, true);
+        std::string text = record.str();
+        text.pop_back();  // the newline ending the document
+
+        os << (empty ? "\n" : ",\n") << std::string(8, ' ');
+        size_t begin = 0, end;
+        while ((end = text.find('\n', begin)) != std::string::npos) {
+            os.write(text.data() + begin, end + 1 - begin);
+            os << std::string(8, ' ');
+            begin = end + 1;
+        }
+        os.write(text.data() + begin, text.size() - begin);
+        empty = false;
+    }
+
+    void finish() {
+        if (!empty)
+            os << "\n    ";
+        os << "]\n}" << std::endl;
+    }
+};
+
+// Cuts the records out of the "info" array and parses them one by one
+class JsonResultReader {
+    std::istream& is;
+    bool inArray = false;
+    bool done = false;
+
+    // reads up to and including the closing quote of a string
+    void skipString(std::string& text) {
+        char c;
+        while (is.get(c)) {
+            text += c;
+            if (c == '\\') {
+                if (is.get(c))
+                    text += c;
+            } else if (c == '"') {
+                return;
+            }
+        }
+    }
+
+   public:
+    explicit JsonResultReader(std::istream& is) : is(is) {}
+
+    bool read(boost::property_tree::ptree& pt) {
+        char c;
+        std::string text;
+        // find the "info" array, then the next record in it
+        while (!done && is.get(c)) {
+            if (c == '"') {
+                skipString(text);
+                text.clear();
+            } else if (c == '[' && !inArray) {
+                inArray = true;
+            } else if ((c == ']' && inArray) || (c == '}' && !inArray)) {
+                done = true;
+            } else if (c == '{' && inArray) {
+                break;
+            }
+        }
+        if (done || !is)
+            return false;
+
+        int depth = 1;
+        text = "{";
+        while (depth && is.get(c)) {
+            text += c;
+            if (c == '"')
+                skipString(text);
+            else if (c == '{' || c == '[')
+                depth++;
+            else if (c == '}' || c == ']')
+                depth--;
+        }
+        std::istringstream record(text);
+        pt.clear();
+        boost::property_tree::read_json(record, pt);
+        return true;
+    }
+};
+
+// Binary results: a header, the records, then a table of the distinct
+// strings they use. A record is its number of fields followed by a
+// (path, value) pair of string indexes per field, where the path is the
+// dotted ptree path of a leaf. All integers are host-endian.
+struct BinaryResultHeader {
+    static constexpr char const* MAGIC = "MFZRSLT1";
+
+    char magic[8];
+    uint32_t version;
+    uint32_t stringCount;
+    uint64_t recordCount;
+    uint64_t stringTableOffset;
+};
+
+// The header is rewritten by finish(), so os must be seekable
+class BinaryResultWriter {
+    std::ostream& os;
+    BinaryResultHeader header;
+    std::unordered_map<std::string, uint32_t> stringIds;
+    std::vector<const std::string*> strings;
+    std::vector<uint32_t> fields;
+
+    uint32_t intern(const std::string& str) {
+        auto [iter, inserted] = stringIds.emplace(str, strings.size());
+        if (inserted)
+            strings.push_back(&iter->first);
+        return iter->second;
+    }
+
+    void flatten(const boost::property_tree::ptree& pt, const std::string& path) {
+        for (auto& child : pt) {
+            std::string childPath = path.empty() ? child.first : path + "." + child.first;
+            if (child.second.empty()) {
+                fields.push_back(intern(childPath));
+                fields.push_back(intern(child.second.data()));
+            } else {
+                flatten(child.second, childPath);
+            }
+        }
+    }
+
+    void writeU32(uint32_t val) { os.write(reinterpret_cast<const char*>(&val), sizeof(val)); }
+
+   public:
+    explicit BinaryResultWriter(std::ostream& os) : os(os) {
+        std::memcpy(header.magic, BinaryResultHeader::MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.stringCount = 0;
+        header.recordCount = 0;
+        header.stringTableOffset = 0;
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void write(const boost::property_tree::ptree& pt) {
+        fields.clear();
+        flatten(pt, "");
+        writeU32(fields.size() / 2);
+        os.write(reinterpret_cast<const char*>(fields.data()), fields.size() * sizeof(uint32_t));
+        header.recordCount++;
+    }
+
+    void finish() {
+        header.stringCount = strings.size();
+        header.stringTableOffset = os.tellp();
+        for (const std::string* str : strings) {
+            writeU32(str->size());
+            os.write(str->data(), str->size());
+        }
+        os.seekp(0);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.seekp(0, std::ios::end);
+        os.flush();
+    }
+};
+
+// Loads the string table up front, then decodes one record per read()
+class BinaryResultReader {
+    std::istream& is;
+    BinaryResultHeader header;
+    std::vector<std::string> strings;
+    uint64_t recordsLeft = 0;
+
+    bool readU32(uint32_t& val) { return bool(is.read(reinterpret_cast<char*>(&val), sizeof(val))); }
+
+   public:
+    static bool isBinary(std::istream& is) {
+        char magic[8];
+        bool binary = is.read(magic, sizeof(magic)) &&
+                      !std::memcmp(magic, BinaryResultHeader::MAGIC, sizeof(magic));
+        is.clear();
+        is.seekg(0);
+        return binary;
+    }
+
+    explicit BinaryResultReader(std::istream& is) : is(is) {
+        if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, BinaryResultHeader::MAGIC, sizeof(header.magic)) ||
+            header.version != 1) {
+            throw std::runtime_error("not a binary analysis result");
+        }
+        is.seekg(header.stringTableOffset);
+        strings.resize(header.stringCount);
+        for (std::string& str : strings) {
+            uint32_t size;
+            if (!readU32(size))
+                throw std::runtime_error("truncated string table");
+            str.resize(size);
+            is.read(str.data(), size);
+        }
+        if (!is)
+            throw std::runtime_error("truncated string table");
+        is.seekg(sizeof(header));
+        recordsLeft = header.recordCount;
+    }
+
+    bool read(boost::property_tree::ptree& pt) {
+        uint32_t fieldCount;
+        if (!recordsLeft || !readU32(fieldCount))
+            return false;
+        recordsLeft--;
+        pt.clear();
+        for (uint32_t i = 0; i < fieldCount; i++) {
+            uint32_t path, value;
+            if (!readU32(path) || !readU32(value) ||
+                path >= strings.size() || value >= strings.size())
+                throw std::runtime_error("corrupt record");
+            pt.put(boost::property_tree::ptree::path_type(strings[path], '.'), strings[value]);
+        }
+        return true;
+    }
+};
+
+}  // namespace mfuzz
+#endif
@@ -0,0 +1,76 @@
+#ifndef SOURCE_LINE_CACHE_H
+#define SOURCE_LINE_CACHE_H
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace mfuzz {
+
+// A source file mapped into memory with the offset of every line
+class SourceFile {
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+    std::vector<size_t> lineStarts;  // lineStarts[n] is where line n+1 starts
+    size_t terminatedLines = 0;       // lines ending with '\n'
+
+   public:
+    explicit SourceFile(std::unique_ptr<llvm::MemoryBuffer> buffer) : buffer(std::move(buffer)) {
+        llvm::StringRef text = this->buffer->getBuffer();
+        lineStarts.push_back(0);
+        for (size_t pos = text.find('\n'); pos != llvm::StringRef::npos; pos = text.find('\n', pos + 1)) {
+            lineStarts.push_back(pos + 1);
+            terminatedLines++;
+        }
+    }
+
+    size_t terminatedLineCount() const { return terminatedLines; }
+
+    // Line number lineNo (from 1) as the lineNo-th std::getline on the file
+    // would return it. Returns whether the stream would still be good,
+    // i.e. whether the line ended with '\n'.
+    bool getLine(size_t lineNo, llvm::StringRef& line) const {
+        llvm::StringRef text = buffer->getBuffer();
+        if (lineNo >= 1 && lineNo <= terminatedLines) {
+            size_t start = lineStarts[lineNo - 1];
+            line = text.slice(start, lineStarts[lineNo] - 1);
+            return true;
+        }
+        // the unterminated last line if any, then nothing
+        size_t start = lineStarts.back();
+        line = lineNo == terminatedLines + 1 ? text.substr(start) : llvm::StringRef();
+        return false;
+    }
+};
+
+// Source files by path, each read once for the whole run. Safe to use from
+// several threads.
+class SourceLineCache {
+    std::mutex lock;
+    std::map<std::string, std::unique_ptr<SourceFile>> files;
+
+   public:
+    static SourceLineCache& instance() {
+        static SourceLineCache cache;
+        return cache;
+    }
+
+    // nullptr if path cannot be read
+    const SourceFile* get(const std::string& path) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto iter = files.find(path);
+        if (iter == files.end()) {
+            std::unique_ptr<SourceFile> file;
+            if (auto bufferOrErr = llvm::MemoryBuffer::getFile(path))
+                file = std::make_unique<SourceFile>(std::move(*bufferOrErr));
+            iter = files.emplace(path, std::move(file)).first;
+        }
+        return iter->second.get();
+    }
+};
+
+}  // namespace mfuzz
+#endif
@@ -0,0 +1,45 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace mfuzz {
+
+using SymbolId = uint32_t;
+
+// Dense ids for names: the n-th distinct name interned gets id n, so
+// tables keyed by name can be vectors indexed by id. Not thread-safe.
+class SymbolTable {
+    llvm::StringMap<SymbolId> ids;
+    std::vector<llvm::StringRef> names;  // point into the keys of ids
+
+   public:
+    static constexpr SymbolId NO_SYMBOL = ~0u;
+
+    SymbolId intern(llvm::StringRef name) {
+        auto [iter, inserted] = ids.try_emplace(name, names.size());
+        if (inserted)
+            names.push_back(iter->getKey());
+        return iter->second;
+    }
+
+    // NO_SYMBOL if name was never interned
+    SymbolId lookup(llvm::StringRef name) const {
+        auto iter = ids.find(name);
+        return iter == ids.end() ? NO_SYMBOL : iter->second;
+    }
+
+    llvm::StringRef name(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    void clear() {
+        ids.clear();
+        names.clear();
+    }
+};
+
+}  // namespace mfuzz
+#endif
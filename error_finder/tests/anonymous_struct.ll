@@ -0,0 +1,60 @@
+; Members of anonymous structs: clang names the TBAA base type of
+; `typedef struct { ... } T;` "", and unnamed literal structs reach the
+; GEP decoding. Neither may be reported, nor crash the analysis.
+
+%struct.T = type { i32, i8* }
+
+define void @tbaa_member(%struct.T* %t) !dbg !10 {
+entry:
+  %fp = getelementptr inbounds %struct.T, %struct.T* %t, i32 0, i32 1
+  %ld = load i8*, i8** %fp, align 8, !dbg !11, !tbaa !8
+  %nc = icmp eq i8* %ld, null, !dbg !12
+  br i1 %nc, label %isnull, label %done, !dbg !12
+
+isnull:
+  store i8* null, i8** %fp, align 8, !dbg !13, !tbaa !8
+  br label %done, !dbg !13
+
+done:
+  ret void, !dbg !14
+}
+
+define void @literal_member({ i32, i8* }* %t) !dbg !20 {
+entry:
+  %fp = getelementptr inbounds { i32, i8* }, { i32, i8* }* %t, i32 0, i32 1
+  %ld = load i8*, i8** %fp, align 8, !dbg !21, !tbaa !9
+  %nc = icmp eq i8* %ld, null, !dbg !22
+  br i1 %nc, label %isnull, label %done, !dbg !22
+
+isnull:
+  store i8* null, i8** %fp, align 8, !dbg !23, !tbaa !9
+  br label %done, !dbg !23
+
+done:
+  ret void, !dbg !24
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2, !3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "anonymous_struct.c", directory: "/tmp")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !{i32 7, !"Dwarf Version", i32 4}
+!4 = !{!"Simple C/C++ TBAA"}
+!5 = !{!"omnipotent char", !4, i64 0}
+!6 = !{!"any pointer", !5, i64 0}
+!7 = !{!"", !5, i64 0, !6, i64 8}
+!8 = !{!7, !6, i64 8}
+!9 = !{!6, !6, i64 0}
+!15 = !DISubroutineType(types: !{})
+!10 = distinct !DISubprogram(name: "tbaa_member", scope: !1, file: !1, line: 1, type: !15, unit: !0)
+!11 = !DILocation(line: 2, column: 3, scope: !10)
+!12 = !DILocation(line: 3, column: 3, scope: !10)
+!13 = !DILocation(line: 4, column: 3, scope: !10)
+!14 = !DILocation(line: 5, column: 1, scope: !10)
+!20 = distinct !DISubprogram(name: "literal_member", scope: !1, file: !1, line: 7, type: !15, unit: !0)
+!21 = !DILocation(line: 8, column: 3, scope: !20)
+!22 = !DILocation(line: 9, column: 3, scope: !20)
+!23 = !DILocation(line: 10, column: 3, scope: !20)
+!24 = !DILocation(line: 11, column: 1, scope: !20)
@@ -0,0 +1,120 @@
+; Checks of a return value that isCheckRet (--taintChecks) finds by taint
+; dataflow: one reached only through the back edge of a loop, and one a
+; dozen blocks below the call. ext_five is compared, but never against 0,
+; so it is a check for the alias analysis only.
+
+declare i8* @ext_loop()
+declare i8* @ext_far()
+declare i32 @ext_five()
+
+define void @back_edge(i32 %n) !dbg !10 {
+entry:
+  %p = alloca i8*, align 8
+  store i8* inttoptr (i64 1 to i8*), i8** %p, align 8
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %inc, %body ]
+  %v = load i8*, i8** %p, align 8
+  %isnull = icmp eq i8* %v, null
+  br i1 %isnull, label %done, label %latch
+
+latch:
+  %more = icmp slt i32 %i, %n
+  br i1 %more, label %body, label %done
+
+body:
+  %r = call i8* @ext_loop(), !dbg !11
+  store i8* %r, i8** %p, align 8
+  %inc = add i32 %i, 1
+  br label %header
+
+done:
+  ret void
+}
+
+define void @far_below() !dbg !20 {
+entry:
+  %p = alloca i8*, align 8
+  %r = call i8* @ext_far(), !dbg !21
+  store i8* %r, i8** %p, align 8
+  br label %b0
+
+b0:
+  br label %b1
+
+b1:
+  br label %b2
+
+b2:
+  br label %b3
+
+b3:
+  br label %b4
+
+b4:
+  br label %b5
+
+b5:
+  br label %b6
+
+b6:
+  br label %b7
+
+b7:
+  br label %b8
+
+b8:
+  br label %b9
+
+b9:
+  br label %b10
+
+b10:
+  br label %b11
+
+b11:
+  br label %b12
+
+b12:
+  %v = load i8*, i8** %p, align 8
+  %isnull = icmp eq i8* %v, null
+  br i1 %isnull, label %fail, label %done
+
+fail:
+  br label %done
+
+done:
+  ret void
+}
+
+define void @not_zero() !dbg !30 {
+entry:
+  %p = alloca i32, align 4
+  %r = call i32 @ext_five(), !dbg !31
+  store i32 %r, i32* %p, align 4
+  %v = load i32, i32* %p, align 4
+  %isfive = icmp eq i32 %v, 5
+  br i1 %isfive, label %five, label %done
+
+five:
+  br label %done
+
+done:
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2, !3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "taint_checks.c", directory: "/tmp")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !{i32 7, !"Dwarf Version", i32 4}
+!4 = !DISubroutineType(types: !{})
+!10 = distinct !DISubprogram(name: "back_edge", scope: !1, file: !1, line: 1, type: !4, unit: !0)
+!11 = !DILocation(line: 5, column: 9, scope: !10)
+!20 = distinct !DISubprogram(name: "far_below", scope: !1, file: !1, line: 10, type: !4, unit: !0)
+!21 = !DILocation(line: 11, column: 9, scope: !20)
+!30 = distinct !DISubprogram(name: "not_zero", scope: !1, file: !1, line: 30, type: !4, unit: !0)
+!31 = !DILocation(line: 31, column: 9, scope: !30)
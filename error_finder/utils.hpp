@@ -20,21 +20,18 @@ void eraseAll(std::string& str, char toErase) {
 }
 
 template <class ...UserClasses>
-bool isValueUsedBy(llvm::Value& val, llvm::Function& caller) {
-    std::vector<llvm::Value*> aliasValues;
-    GetAliasValueInsensitive(&val, &caller, aliasValues);
-
-    for (auto& alias_val : aliasValues) {
-        for(auto user : alias_val->users()) {
-            bool isUsed = false;
-            ((isUsed |= llvm::isa<UserClasses>(user)), ...);
-            
-            if (isUsed) {
-                return true;
-            }
-        }
-    }
-    return false;
+bool isUserOf(llvm::User* user) {
+    bool isUsed = false;
+    ((isUsed |= llvm::isa<UserClasses>(user)), ...);
+    return isUsed;
+}
+
+// aliasIndex is the alias index of the function containing val
+template <class ...UserClasses>
+bool isValueUsedBy(llvm::Value& val, FunctionAliasIndex& aliasIndex) {
+    // one query key per set of user classes
+    static const char query = 0;
+    return aliasIndex.IsAliasUsedBy(&val, &query, isUserOf<UserClasses...>);
 }
 
 template <class ...UserClasses>
@@ -2,22 +2,192 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/CFG.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cmath>
 #include <queue>
+#include <set>
 #include <unordered_map>
 #include <fstream>
+#include <iterator>
+
+#include "DistanceMapFormat.h"
 
 using namespace llvm;
 
 namespace {
 
+enum DistanceFormat { DF_Text, DF_Binary };
+
+cl::opt<DistanceFormat> DistanceOutputFormat(
+    "cfg-distance-format", cl::desc("Format of the distance map"),
+    cl::values(clEnumValN(DF_Text, "text", "Line1 Line2 Distance rows"),
+               clEnumValN(DF_Binary, "binary",
+                          "sorted mmap-able table (DistanceMapFormat.h)")),
+    cl::init(DF_Binary));
+
+cl::opt<std::string> DistanceOutputFile(
+    "cfg-distance-output",
+    cl::desc("Output file (default: cfg_distances.txt or cfg_distances.bin)"),
+    cl::value_desc("filename"));
+
+cl::opt<std::string> DistanceTargetsFile(
+    "cfg-distance-targets",
+    cl::desc("Error points (err_cluster.txt or ErrorFinder .faultsite); "
+             "emit each line's distance to the nearest one instead of "
+             "all-pairs distances"),
+    cl::value_desc("filename"));
+
+cl::opt<bool> DistanceInterprocedural(
+    "cfg-distance-interprocedural",
+    cl::desc("With -cfg-distance-targets, combine call-graph and CFG "
+             "distances (AFLGo style) so callers of the target functions "
+             "get a distance too"));
+
+cl::opt<unsigned> DistanceJobs(
+    "cfg-distance-jobs",
+    cl::desc("Threads for the per-function distances (0 = all cores)"),
+    cl::init(0));
+
+// AFLGo's weight of one call-graph edge relative to one CFG edge
+const double kCallGraphWeight = 10;
+
+typedef std::pair<uint64_t, int32_t> DistanceEntry;
+
+// An error point; an empty file name matches the line in any file.
+typedef std::pair<std::string, unsigned> TargetLocation;
+
+bool parseLocation(StringRef Text, TargetLocation &Loc) {
+  Text = Text.trim();
+  StringRef File, Line = Text;
+  if (Text.contains(':')) {
+    std::tie(File, Line) = Text.split(':');
+    // "file:line: instruction" as printed by ErrorPointCluster
+    Line = Line.split(':').first;
+  }
+  unsigned LineNo;
+  if (Line.trim().getAsInteger(10, LineNo) || LineNo == 0)
+    return false;
+  Loc = TargetLocation(File.str(), LineNo);
+  return true;
+}
+
+// Reads a .faultsite JSON file ({"info": [{"fileName", "lineNumber"}]}) or
+// a text file with one "file:line" / "line" per row. err_cluster.txt rows
+// look like "Error point: file:line: ..." and its "Cluster:" rows are
+// skipped.
+bool readTargets(StringRef Path, std::set<TargetLocation> &Targets) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+  if (!Buf) {
+    errs() << "Error: Unable to read targets " << Path << ": "
+           << Buf.getError().message() << "\n";
+    return false;
+  }
+
+  StringRef Content = (*Buf)->getBuffer();
+  if (Content.ltrim().startswith("{")) {
+    Expected<json::Value> Root = json::parse(Content);
+    if (!Root) {
+      errs() << "Error: " << Path << ": " << toString(Root.takeError())
+             << "\n";
+      return false;
+    }
+    const json::Object *Obj = Root->getAsObject();
+    const json::Array *Info = Obj ? Obj->getArray("info") : nullptr;
+    if (!Info) {
+      errs() << "Error: " << Path << ": no \"info\" array\n";
+      return false;
+    }
+    for (const json::Value &Item : *Info) {
+      const json::Object *Site = Item.getAsObject();
+      if (!Site)
+        continue;
+      Optional<StringRef> File = Site->getString("fileName");
+      if (!File)
+        continue;
+      // boost::property_tree writes every value as a string
+      TargetLocation Loc;
+      if (Optional<StringRef> Line = Site->getString("lineNumber")) {
+        if (parseLocation(*Line, Loc))
+          Targets.insert(TargetLocation(File->str(), Loc.second));
+      } else if (Optional<int64_t> Line = Site->getInteger("lineNumber")) {
+        if (*Line > 0)
+          Targets.insert(TargetLocation(File->str(), *Line));
+      }
+    }
+    return true;
+  }
+
+  SmallVector<StringRef, 64> Rows;
+  Content.split(Rows, '\n', -1, false);
+  for (StringRef Row : Rows) {
+    Row = Row.trim();
+    Row.consume_front("Error point:");
+    if (Row.empty() || Row.endswith(":"))
+      continue;
+    TargetLocation Loc;
+    if (parseLocation(Row, Loc))
+      Targets.insert(Loc);
+  }
+  return true;
+}
+
 class GlobalCFGDistancePass : public PassInfoMixin<GlobalCFGDistancePass> {
 public:
-  explicit GlobalCFGDistancePass(std::string OutputFile)
-      : OutputFile(std::move(OutputFile)) {}
+  GlobalCFGDistancePass(std::string OutputFile, DistanceFormat Format,
+                        std::string TargetsFile, bool Interprocedural,
+                        unsigned Jobs)
+      : OutputFile(std::move(OutputFile)), Format(Format),
+        TargetsFile(std::move(TargetsFile)),
+        Interprocedural(Interprocedural), Jobs(Jobs) {}
 
   PreservedAnalyses run(Module &M, ModuleAnalysisManager &) {
+    std::vector<DistanceEntry> Entries;
+    std::vector<uint64_t> Reach;
+    hunt::DistanceKind Kind = hunt::DK_Pairwise;
+
+    if (TargetsFile.empty()) {
+      computePairwise(M, Entries);
+    } else {
+      std::set<TargetLocation> Targets;
+      if (!readTargets(TargetsFile, Targets))
+        return PreservedAnalyses::all();
+      if (Interprocedural) {
+        computeInterprocedural(M, Targets, Entries);
+        Kind = hunt::DK_Interprocedural;
+      } else {
+        computeToTargets(M, Targets, Entries);
+        Kind = hunt::DK_ToTarget;
+      }
+      computeReachability(M, Targets, Reach);
+    }
+
+    bool Written = Format == DF_Binary ? writeBinary(Entries, Kind, Reach)
+                                       : writeText(Entries);
+    if (!Written)
+      errs() << "Error: Unable to open output file.\n";
+    return PreservedAnalyses::all();
+  }
+
+private:
+  std::string OutputFile;
+  DistanceFormat Format;
+  std::string TargetsFile;
+  bool Interprocedural;
+  unsigned Jobs;
+
+  void computePairwise(Module &M, std::vector<DistanceEntry> &Entries) {
     std::unordered_map<unsigned, BasicBlock *> LineToBB;
 
     for (Function &F : M) {
@@ -33,30 +203,357 @@ public:
       }
     }
 
-    
-    std::ofstream OutFile(OutputFile);
-    if (!OutFile.is_open()) {
-      errs() << "Error: Unable to open output file.\n";
-      return PreservedAnalyses::all();
-    }
-
     for (auto It1 = LineToBB.begin(); It1 != LineToBB.end(); ++It1) {
       for (auto It2 = std::next(It1); It2 != LineToBB.end(); ++It2) {
         unsigned Line1 = It1->first, Line2 = It2->first;
         BasicBlock *BB1 = It1->second, *BB2 = It2->second;
 
         int Distance = computeDistance(BB1, BB2);
-        OutFile << Line1 << " " << Line2 << " " << Distance << "\n";
-        OutFile << Line2 << " " << Line1 << " " << Distance << "\n"; 
+        Entries.emplace_back(hunt::huntDistanceKey(Line1, Line2), Distance);
+        Entries.emplace_back(hunt::huntDistanceKey(Line2, Line1), Distance);
       }
     }
+  }
 
-    OutFile.close();
-    return PreservedAnalyses::all();
+  // One multi-source BFS over reversed CFG edges, seeded with every block
+  // that holds a target, gives each block its distance to the nearest
+  // target in O(V + E). A line gets the smallest distance of its blocks.
+  void computeToTargets(Module &M, const std::set<TargetLocation> &Targets,
+                        std::vector<DistanceEntry> &Entries) {
+    std::unordered_map<BasicBlock *, int> Distances;
+    std::queue<BasicBlock *> Queue;
+
+    for (Function &F : M) {
+      for (BasicBlock &BB : F) {
+        for (Instruction &I : BB) {
+          const DILocation *Loc = I.getDebugLoc().get();
+          if (!Loc || !isTarget(Targets, Loc))
+            continue;
+          Distances[&BB] = 0;
+          Queue.push(&BB);
+          break;
+        }
+      }
+    }
+
+    if (Queue.empty())
+      errs() << "Warning: no target of " << TargetsFile << " found in "
+             << M.getName() << "\n";
+
+    while (!Queue.empty()) {
+      BasicBlock *Current = Queue.front();
+      Queue.pop();
+
+      int CurrentDistance = Distances[Current];
+      for (BasicBlock *Pred : predecessors(Current)) {
+        if (Distances.emplace(Pred, CurrentDistance + 1).second)
+          Queue.push(Pred);
+      }
+    }
+
+    std::unordered_map<unsigned, int> LineDistances;
+    for (auto &BBDistance : Distances)
+      addLineDistances(*BBDistance.first, BBDistance.second, LineDistances);
+    addEntries(LineDistances, Entries);
   }
 
-private:
-  std::string OutputFile;
+  // AFLGo's distance: a function's call-graph distance df is the harmonic
+  // mean of its shortest call chains to the target functions. A block is 0
+  // if it holds a target, c * min df(callee) if it calls towards a target,
+  // and otherwise the harmonic mean of (CFG distance + distance) over those
+  // anchor blocks of its function. Functions are independent once df is
+  // known, so their block distances are computed on a thread pool.
+  void computeInterprocedural(Module &M,
+                              const std::set<TargetLocation> &Targets,
+                              std::vector<DistanceEntry> &Entries) {
+    std::vector<Function *> Functions;
+    DenseMap<Function *, unsigned> FunctionIndex;
+    for (Function &F : M) {
+      if (F.isDeclaration())
+        continue;
+      FunctionIndex[&F] = Functions.size();
+      Functions.push_back(&F);
+    }
+
+    // reversed direct call graph and the functions holding a target
+    std::vector<SmallVector<unsigned, 4>> Callers(Functions.size());
+    std::vector<unsigned> TargetFunctions;
+    for (unsigned Idx = 0; Idx < Functions.size(); Idx++) {
+      bool HasTarget = false;
+      for (Instruction &I : instructions(*Functions[Idx])) {
+        const DILocation *Loc = I.getDebugLoc().get();
+        if (Loc && isTarget(Targets, Loc))
+          HasTarget = true;
+        auto *Call = dyn_cast<CallBase>(&I);
+        Function *Callee = Call ? Call->getCalledFunction() : nullptr;
+        auto It = Callee ? FunctionIndex.find(Callee) : FunctionIndex.end();
+        if (It != FunctionIndex.end())
+          Callers[It->second].push_back(Idx);
+      }
+      if (HasTarget)
+        TargetFunctions.push_back(Idx);
+    }
+
+    if (TargetFunctions.empty()) {
+      errs() << "Warning: no target of " << TargetsFile << " found in "
+             << M.getName() << "\n";
+      return;
+    }
+
+    ThreadPool Pool(hardware_concurrency(Jobs));
+
+    // one reverse BFS per target function, summed as 1 / distance
+    std::vector<std::vector<int>> CallDistances(TargetFunctions.size());
+    for (unsigned T = 0; T < TargetFunctions.size(); T++)
+      Pool.async([&, T] {
+        CallDistances[T] = reverseBFS(Callers, TargetFunctions[T]);
+      });
+    Pool.wait();
+
+    std::vector<double> FunctionDistances(Functions.size(), -1);
+    for (unsigned Idx = 0; Idx < Functions.size(); Idx++) {
+      double Sum = 0;
+      for (const std::vector<int> &Distances : CallDistances)
+        if (Distances[Idx] >= 0)
+          Sum += 1.0 / (1 + Distances[Idx]);
+      if (Sum > 0)
+        FunctionDistances[Idx] = 1 / Sum - 1;
+    }
+
+    std::vector<std::unordered_map<unsigned, int>> LineDistances(
+        Functions.size());
+    for (unsigned Idx = 0; Idx < Functions.size(); Idx++)
+      Pool.async([&, Idx] {
+        computeBlockDistances(*Functions[Idx], Targets, FunctionIndex,
+                              FunctionDistances, LineDistances[Idx]);
+      });
+    Pool.wait();
+
+    std::unordered_map<unsigned, int> ModuleLineDistances;
+    for (auto &FunctionLines : LineDistances)
+      for (auto &LineDistance : FunctionLines) {
+        auto Inserted = ModuleLineDistances.insert(LineDistance);
+        if (!Inserted.second && LineDistance.second < Inserted.first->second)
+          Inserted.first->second = LineDistance.second;
+      }
+    addEntries(ModuleLineDistances, Entries);
+  }
+
+  static std::vector<int>
+  reverseBFS(const std::vector<SmallVector<unsigned, 4>> &Callers,
+             unsigned Target) {
+    std::vector<int> Distances(Callers.size(), -1);
+    std::queue<unsigned> Queue;
+    Distances[Target] = 0;
+    Queue.push(Target);
+    while (!Queue.empty()) {
+      unsigned Current = Queue.front();
+      Queue.pop();
+      for (unsigned Caller : Callers[Current]) {
+        if (Distances[Caller] < 0) {
+          Distances[Caller] = Distances[Current] + 1;
+          Queue.push(Caller);
+        }
+      }
+    }
+    return Distances;
+  }
+
+  static void
+  computeBlockDistances(Function &F, const std::set<TargetLocation> &Targets,
+                        const DenseMap<Function *, unsigned> &FunctionIndex,
+                        const std::vector<double> &FunctionDistances,
+                        std::unordered_map<unsigned, int> &LineDistances) {
+    // anchors: target blocks and blocks calling towards a target
+    DenseMap<BasicBlock *, double> Anchors;
+    for (BasicBlock &BB : F) {
+      double Distance = -1;
+      for (Instruction &I : BB) {
+        const DILocation *Loc = I.getDebugLoc().get();
+        if (Loc && isTarget(Targets, Loc)) {
+          Distance = 0;
+          break;
+        }
+        auto *Call = dyn_cast<CallBase>(&I);
+        Function *Callee = Call ? Call->getCalledFunction() : nullptr;
+        auto It = Callee ? FunctionIndex.find(Callee) : FunctionIndex.end();
+        if (It == FunctionIndex.end() || FunctionDistances[It->second] < 0)
+          continue;
+        double CallDistance =
+            kCallGraphWeight * FunctionDistances[It->second];
+        if (Distance < 0 || CallDistance < Distance)
+          Distance = CallDistance;
+      }
+      if (Distance >= 0)
+        Anchors[&BB] = Distance;
+    }
+
+    DenseMap<BasicBlock *, double> Sums;
+    for (auto &Anchor : Anchors) {
+      DenseMap<BasicBlock *, int> Distances;
+      std::queue<BasicBlock *> Queue;
+      Distances[Anchor.first] = 0;
+      Queue.push(Anchor.first);
+      while (!Queue.empty()) {
+        BasicBlock *Current = Queue.front();
+        Queue.pop();
+        int CurrentDistance = Distances[Current];
+        Sums[Current] += 1.0 / (1 + CurrentDistance + Anchor.second);
+        for (BasicBlock *Pred : predecessors(Current))
+          if (Distances.try_emplace(Pred, CurrentDistance + 1).second)
+            Queue.push(Pred);
+      }
+    }
+
+    for (auto &Sum : Sums) {
+      auto Anchor = Anchors.find(Sum.first);
+      double Distance =
+          Anchor != Anchors.end() ? Anchor->second : 1 / Sum.second - 1;
+      addLineDistances(*Sum.first,
+                       std::lround(Distance * hunt::kDistanceScale),
+                       LineDistances);
+    }
+  }
+
+  static void addLineDistances(BasicBlock &BB, int Distance,
+                               std::unordered_map<unsigned, int> &Lines) {
+    for (Instruction &I : BB) {
+      const DILocation *Loc = I.getDebugLoc().get();
+      if (!Loc || !Loc->getLine())
+        continue;
+      auto Inserted = Lines.emplace(Loc->getLine(), Distance);
+      if (!Inserted.second && Distance < Inserted.first->second)
+        Inserted.first->second = Distance;
+    }
+  }
+
+  static void addEntries(const std::unordered_map<unsigned, int> &Lines,
+                         std::vector<DistanceEntry> &Entries) {
+    for (auto &LineDistance : Lines)
+      Entries.emplace_back(
+          hunt::huntDistanceKey(LineDistance.first, hunt::kNearestTarget),
+          LineDistance.second);
+  }
+
+  // Lines whose blocks can reach a target along CFG edges, into callees and
+  // back out of them to the rest of their call sites. This over-approximates
+  // (no calling context, indirect calls are ignored on purpose since the
+  // distances cannot follow them either) so a clear bit means the pintool
+  // can skip negating towards that line.
+  void computeReachability(Module &M, const std::set<TargetLocation> &Targets,
+                           std::vector<uint64_t> &Reach) {
+    DenseMap<Function *, SmallVector<BasicBlock *, 4>> CallSites;
+    DenseMap<BasicBlock *, SmallVector<Function *, 2>> Callees;
+    SmallPtrSet<BasicBlock *, 32> Reached;
+    std::queue<BasicBlock *> Queue;
+    unsigned MaxLine = 0;
+
+    for (Function &F : M) {
+      for (BasicBlock &BB : F) {
+        bool HasTarget = false;
+        for (Instruction &I : BB) {
+          if (const DILocation *Loc = I.getDebugLoc().get()) {
+            MaxLine = std::max(MaxLine, Loc->getLine());
+            HasTarget |= isTarget(Targets, Loc);
+          }
+          auto *Call = dyn_cast<CallBase>(&I);
+          Function *Callee = Call ? Call->getCalledFunction() : nullptr;
+          if (Callee && !Callee->isDeclaration()) {
+            CallSites[Callee].push_back(&BB);
+            Callees[&BB].push_back(Callee);
+          }
+        }
+        if (HasTarget && Reached.insert(&BB).second)
+          Queue.push(&BB);
+      }
+    }
+
+    while (!Queue.empty()) {
+      BasicBlock *Current = Queue.front();
+      Queue.pop();
+
+      SmallVector<BasicBlock *, 8> Sources(predecessors(Current));
+      // reaching a function's entry means reaching it from its call sites
+      if (Current->isEntryBlock()) {
+        auto It = CallSites.find(Current->getParent());
+        if (It != CallSites.end())
+          Sources.append(It->second.begin(), It->second.end());
+      }
+      // the rest of a call site runs after the callee returns
+      auto It = Callees.find(Current);
+      if (It != Callees.end())
+        for (Function *Callee : It->second)
+          for (BasicBlock &BB : *Callee)
+            if (isa<ReturnInst>(BB.getTerminator()))
+              Sources.push_back(&BB);
+
+      for (BasicBlock *Source : Sources)
+        if (Reached.insert(Source).second)
+          Queue.push(Source);
+    }
+
+    Reach.assign(hunt::huntReachWords(MaxLine + 1), 0);
+    for (BasicBlock *BB : Reached)
+      for (Instruction &I : *BB)
+        if (const DILocation *Loc = I.getDebugLoc().get())
+          Reach[Loc->getLine() / 64] |= uint64_t(1) << (Loc->getLine() % 64);
+  }
+
+  static bool isTarget(const std::set<TargetLocation> &Targets,
+                       const DILocation *Loc) {
+    unsigned Line = Loc->getLine();
+    return Targets.count(TargetLocation("", Line)) ||
+           Targets.count(TargetLocation(Loc->getFilename().str(), Line));
+  }
+
+  bool writeText(const std::vector<DistanceEntry> &Entries) {
+    std::ofstream OutFile(OutputFile);
+    if (!OutFile.is_open())
+      return false;
+
+    for (const DistanceEntry &E : Entries)
+      OutFile << hunt::huntDistanceFrom(E.first) << " "
+              << hunt::huntDistanceTo(E.first) << " " << E.second << "\n";
+    return true;
+  }
+
+  bool writeBinary(std::vector<DistanceEntry> &Entries,
+                   hunt::DistanceKind Kind,
+                   const std::vector<uint64_t> &Reach) {
+    std::ofstream OutFile(OutputFile, std::ios::binary);
+    if (!OutFile.is_open())
+      return false;
+
+    std::sort(Entries.begin(), Entries.end());
+
+    hunt::DistanceHeader Header;
+    std::memcpy(Header.Magic, hunt::kDistanceMagic, sizeof(Header.Magic));
+    Header.Version = hunt::kDistanceVersion;
+    Header.Kind = Kind;
+    Header.NumEntries = Entries.size();
+    Header.KeyOffset = sizeof(Header);
+    Header.DistanceOffset =
+        Header.KeyOffset + Header.NumEntries * sizeof(uint64_t);
+    uint64_t DistanceEnd =
+        Header.DistanceOffset + Header.NumEntries * sizeof(int32_t);
+    Header.ReachLines = Reach.size() * 64;
+    Header.ReachOffset = alignTo(DistanceEnd, sizeof(uint64_t));
+    OutFile.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+
+    for (const DistanceEntry &E : Entries)
+      OutFile.write(reinterpret_cast<const char *>(&E.first),
+                    sizeof(E.first));
+    for (const DistanceEntry &E : Entries)
+      OutFile.write(reinterpret_cast<const char *>(&E.second),
+                    sizeof(E.second));
+    if (!Reach.empty()) {
+      std::fill_n(std::ostreambuf_iterator<char>(OutFile),
+                  Header.ReachOffset - DistanceEnd, '\0');
+      OutFile.write(reinterpret_cast<const char *>(Reach.data()),
+                    Reach.size() * sizeof(uint64_t));
+    }
+    return OutFile.good();
+  }
 
   int computeDistance(BasicBlock *BB1, BasicBlock *BB2) {
     std::queue<BasicBlock *> Queue;
@@ -81,11 +578,11 @@ private:
       }
     }
 
-    return -1; 
+    return -1;
   }
 };
 
-} 
+}
 
 
 llvm::PassPluginLibraryInfo getGlobalCFGDistancePassPluginInfo() {
@@ -95,7 +592,15 @@ llvm::PassPluginLibraryInfo getGlobalCFGDistancePassPluginInfo() {
                 [](StringRef Name, ModulePassManager &MPM,
                    ArrayRef<PassBuilder::PipelineElement>) {
                   if (Name == "global-cfg-distance") {
-                    MPM.addPass(GlobalCFGDistancePass("cfg_distances.txt"));
+                    std::string OutputFile = DistanceOutputFile;
+                    if (OutputFile.empty())
+                      OutputFile = DistanceOutputFormat == DF_Binary
+                                       ? "cfg_distances.bin"
+                                       : "cfg_distances.txt";
+                    MPM.addPass(GlobalCFGDistancePass(
+                        OutputFile, DistanceOutputFormat,
+                        DistanceTargetsFile, DistanceInterprocedural,
+                        DistanceJobs));
                     return true;
                   }
                   return false;
@@ -0,0 +1,107 @@
+// Prints a binary distance map written by GlobalCFGDistancePass.
+//
+//   DistanceMapDump cfg_distances.bin            header and every entry
+//   DistanceMapDump cfg_distances.bin -header    header only
+//   DistanceMapDump cfg_distances.bin -line 42   entries from/to line 42
+//
+// Entries are printed as "Line1 Line2 Distance", the same rows as the text
+// format, so the output can be diffed against cfg_distances.txt.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DistanceMapFormat.h"
+
+static void usage(const char *Prog) {
+  fprintf(stderr, "usage: %s <distance map> [-header] [-line N]\n", Prog);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2)
+    usage(argv[0]);
+
+  bool HeaderOnly = false;
+  long Line = -1;
+  for (int I = 2; I < argc; I++) {
+    if (!strcmp(argv[I], "-header"))
+      HeaderOnly = true;
+    else if (!strcmp(argv[I], "-line") && I + 1 < argc)
+      Line = strtol(argv[++I], NULL, 10);
+    else
+      usage(argv[0]);
+  }
+
+  int Fd = open(argv[1], O_RDONLY);
+  if (Fd < 0) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  struct stat St;
+  if (fstat(Fd, &St) != 0 ||
+      static_cast<uint64_t>(St.st_size) < sizeof(hunt::DistanceHeader)) {
+    fprintf(stderr, "%s: file too small for a distance map\n", argv[1]);
+    return 1;
+  }
+
+  void *Buf = mmap(NULL, St.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Buf == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+
+  const hunt::DistanceHeader *Header =
+      static_cast<const hunt::DistanceHeader *>(Buf);
+  if (!hunt::isValidHuntDistanceHeader(*Header, St.st_size)) {
+    fprintf(stderr, "%s: not a valid distance map (version %u expected)\n",
+            argv[1], hunt::kDistanceVersion);
+    return 1;
+  }
+
+  printf("version:   %u\n", Header->Version);
+  printf("kind:      %u\n", Header->Kind);
+  printf("entries:   %llu\n",
+         static_cast<unsigned long long>(Header->NumEntries));
+  printf("keys:      @%llu\n",
+         static_cast<unsigned long long>(Header->KeyOffset));
+  printf("distances: @%llu\n",
+         static_cast<unsigned long long>(Header->DistanceOffset));
+  printf("reach:     %llu lines @%llu\n",
+         static_cast<unsigned long long>(Header->ReachLines),
+         static_cast<unsigned long long>(Header->ReachOffset));
+  if (HeaderOnly)
+    return 0;
+
+  const char *Base = static_cast<const char *>(Buf);
+  const uint64_t *Keys =
+      reinterpret_cast<const uint64_t *>(Base + Header->KeyOffset);
+  const int32_t *Distances =
+      reinterpret_cast<const int32_t *>(Base + Header->DistanceOffset);
+
+  for (uint64_t I = 0; I < Header->NumEntries; I++) {
+    uint32_t From = hunt::huntDistanceFrom(Keys[I]);
+    uint32_t To = hunt::huntDistanceTo(Keys[I]);
+    if (Line >= 0 && From != Line && To != Line)
+      continue;
+    printf("%u %u %d\n", From, To, Distances[I]);
+  }
+
+  const uint64_t *Reach =
+      reinterpret_cast<const uint64_t *>(Base + Header->ReachOffset);
+  for (uint64_t L = 0; L < Header->ReachLines; L++) {
+    if (Line >= 0 && L != static_cast<uint64_t>(Line))
+      continue;
+    if (hunt::huntCanReach(Reach, Header->ReachLines, L))
+      printf("reach %llu\n", static_cast<unsigned long long>(L));
+  }
+
+  munmap(Buf, St.st_size);
+  return 0;
+}
@@ -0,0 +1,110 @@
+#ifndef HUNT_DISTANCE_MAP_FORMAT_H
+#define HUNT_DISTANCE_MAP_FORMAT_H
+
+// On-disk layout of the binary distance map written by GlobalCFGDistancePass
+// and mmap'ed read-only by the concolic pintool. Kept free of LLVM and Pin
+// headers so that both sides (and DistanceMapDump) can include it.
+//
+//   HuntDistanceHeader
+//   uint64_t keys[NumEntries]       sorted ascending, see huntDistanceKey()
+//   int32_t  distances[NumEntries]  distances[i] belongs to keys[i]
+//   uint64_t reach[]                optional, bit L set if line L can reach
+//                                   a target; ReachLines bits, 8-byte aligned
+
+#include <cstdint>
+#include <cstring>
+
+namespace hunt {
+
+static const char kDistanceMagic[8] = {'H', 'U', 'N', 'T', 'D', 'M', 'A', 'P'};
+static const uint32_t kDistanceVersion = 2;
+
+enum DistanceKind : uint32_t {
+  // keys are (FromLine, ToLine) pairs
+  DK_Pairwise = 0,
+  // keys are (FromLine, kNearestTarget), the distance to the closest target
+  DK_ToTarget = 1,
+  // keys as DK_ToTarget; AFLGo-style call-graph + CFG distances in
+  // 1/kDistanceScale units
+  DK_Interprocedural = 2,
+};
+
+static const int32_t kDistanceScale = 100;
+
+// ToLine used by DK_ToTarget tables, also in their text form
+static const uint32_t kNearestTarget = 0;
+
+struct DistanceHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Kind;
+  uint64_t NumEntries;
+  uint64_t KeyOffset;
+  uint64_t DistanceOffset;
+  // 0 when the table has no reachability bitset (pairwise tables)
+  uint64_t ReachLines;
+  uint64_t ReachOffset;
+};
+
+inline uint64_t huntReachWords(uint64_t ReachLines) {
+  return ReachLines / 64 + (ReachLines % 64 != 0);
+}
+
+inline bool huntCanReach(const uint64_t *Reach, uint64_t ReachLines,
+                         uint32_t Line) {
+  return Line < ReachLines && (Reach[Line / 64] >> (Line % 64)) & 1;
+}
+
+inline uint64_t huntDistanceKey(uint32_t FromLine, uint32_t ToLine) {
+  return (static_cast<uint64_t>(FromLine) << 32) | ToLine;
+}
+
+inline uint32_t huntDistanceFrom(uint64_t Key) {
+  return static_cast<uint32_t>(Key >> 32);
+}
+
+inline uint32_t huntDistanceTo(uint64_t Key) {
+  return static_cast<uint32_t>(Key);
+}
+
+inline bool isHuntDistanceMagic(const void *Buf) {
+  return std::memcmp(Buf, kDistanceMagic, sizeof(kDistanceMagic)) == 0;
+}
+
+// Whether Bytes bytes at Offset lie within a file of FileSize bytes. Never
+// adds the two, so corrupt offsets cannot wrap around.
+inline bool huntFitsInFile(uint64_t Offset, uint64_t Bytes,
+                           uint64_t FileSize) {
+  return Offset <= FileSize && Bytes <= FileSize - Offset;
+}
+
+// Checks that a mapped file of FileSize bytes holds a complete table.
+inline bool isValidHuntDistanceHeader(const DistanceHeader &H,
+                                      uint64_t FileSize) {
+  if (!isHuntDistanceMagic(H.Magic) || H.Version != kDistanceVersion)
+    return false;
+  if (H.KeyOffset % sizeof(uint64_t) || H.DistanceOffset % sizeof(int32_t))
+    return false;
+  if (H.NumEntries > FileSize / sizeof(uint64_t))
+    return false;
+  uint64_t KeyBytes = H.NumEntries * sizeof(uint64_t);
+  uint64_t DistanceBytes = H.NumEntries * sizeof(int32_t);
+  if (H.KeyOffset < sizeof(DistanceHeader) ||
+      !huntFitsInFile(H.KeyOffset, KeyBytes, FileSize) ||
+      H.DistanceOffset < H.KeyOffset + KeyBytes ||
+      !huntFitsInFile(H.DistanceOffset, DistanceBytes, FileSize))
+    return false;
+  if (H.ReachLines == 0)
+    return true;
+  uint64_t ReachWords = huntReachWords(H.ReachLines);
+  if (H.ReachOffset % sizeof(uint64_t) ||
+      ReachWords > FileSize / sizeof(uint64_t))
+    return false;
+  return H.ReachOffset >= H.DistanceOffset + DistanceBytes &&
+         huntFitsInFile(H.ReachOffset, ReachWords * sizeof(uint64_t),
+                        FileSize);
+}
+
+} // namespace hunt
+
+#endif
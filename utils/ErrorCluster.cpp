@@ -1,15 +1,18 @@
 #include "llvm/Pass.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/IntEqClasses.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h"
+#include <memory>
 #include <vector>
-#include <cstdlib>
-#include <ctime>
-#include <set>
-#include <fstream>
 
 using namespace llvm;
 
@@ -17,118 +20,114 @@ cl::opt<int> k("k", cl::desc("Maximum depth of error point traversal"), cl::valu
 cl::list<int> instructionLines("lines", cl::desc("List of instruction line numbers to cluster"), cl::CommaSeparated);
 
 namespace {
+  // Error points whose k-deep predecessor sets share a block end up in the
+  // same cluster. Blocks are numbered per function so that an ancestor set
+  // is a BitVector, and clusters are merged with union-find: the first
+  // error point seen with a block in its set owns the block, later ones are
+  // joined to it. This keeps the whole pass linear in the total size of the
+  // ancestor sets instead of comparing every pair of error points.
   struct ErrorPointCluster : public FunctionPass {
     static char ID;
     ErrorPointCluster() : FunctionPass(ID) {}
 
+    std::unique_ptr<raw_fd_ostream> output;
+    DenseSet<unsigned> lines;
 
-    std::vector<BasicBlock*> getFatherList(Instruction* inst, Function* F, int k) {
-      std::vector<BasicBlock*> fatherList;
-      std::set<BasicBlock*> visited;
-      std::vector<BasicBlock*> currentLevel = {inst->getParent()};
+    bool doInitialization(Module &) override {
+      for (int lineNum : instructionLines)
+        if (lineNum > 0)
+          lines.insert(lineNum);
+
+      std::error_code EC;
+      output.reset(new raw_fd_ostream("err_cluster.txt", EC, sys::fs::OF_Text));
+      if (EC) {
+        errs() << "Error opening file: " << EC.message() << "\n";
+        output.reset();
+      }
+      return false;
+    }
+
+    bool doFinalization(Module &) override {
+      output.reset();
+      return false;
+    }
+
+    BitVector getFatherSet(BasicBlock* BB, const DenseMap<BasicBlock*, unsigned> &blockIds, int k) {
+      BitVector fatherSet(blockIds.size());
+      std::vector<BasicBlock*> currentLevel = {BB};
       int depth = 0;
 
       while (depth < k && !currentLevel.empty()) {
         std::vector<BasicBlock*> nextLevel;
-        for (auto* BB : currentLevel) {
-          for (auto* pred : predecessors(BB)) {
-            if (visited.find(pred) == visited.end()) {
-              visited.insert(pred);
+        for (auto* cur : currentLevel) {
+          for (auto* pred : predecessors(cur)) {
+            unsigned id = blockIds.lookup(pred);
+            if (!fatherSet.test(id)) {
+              fatherSet.set(id);
               nextLevel.push_back(pred);
-              fatherList.push_back(pred);
             }
           }
         }
-        currentLevel = nextLevel;
+        currentLevel.swap(nextLevel);
         depth++;
       }
 
-      return fatherList;
-    }
-
-    bool isSamePath(bool S_CEI, bool S_i) {
-      return S_CEI == S_i;
-    }
-
-    bool hasCommon(std::vector<BasicBlock*> set1, std::vector<BasicBlock*> set2) {
-      for (auto& bb1 : set1) {
-        for (auto& bb2 : set2) {
-          if (bb1 == bb2) {
-            return true;
-          }
-        }
-      }
-      return false;
+      return fatherSet;
     }
 
     bool runOnFunction(Function &F) override {
+      if (!output || lines.empty())
+        return false;
 
+      // one pass over the function finds every requested line
+      DenseMap<BasicBlock*, unsigned> blockIds;
       std::vector<Instruction*> errorPoints;
-      std::vector<std::vector<BasicBlock*>> bbkSetList;
-      std::vector<bool> S(instructionLines.size(), false);  
-
-      std::vector<std::vector<Instruction*>> EPC;  
-
-      for (auto lineNum : instructionLines) {
-        for (auto &BB : F) {
-          for (auto &I : BB) {
-            if (I.getDebugLoc() && I.getDebugLoc()->getLine() == lineNum) {
-              errorPoints.push_back(&I);
-              bbkSetList.push_back(getFatherList(&I, &F, k));
-            }
-          }
+      for (auto &BB : F) {
+        unsigned id = blockIds.size();
+        blockIds[&BB] = id;
+        for (auto &I : BB) {
+          const DebugLoc &Loc = I.getDebugLoc();
+          if (Loc && lines.count(Loc.getLine()))
+            errorPoints.push_back(&I);
         }
       }
-
-      
-      std::error_code EC;
-      raw_fd_ostream output("err_cluster.txt", EC, sys::fs::OF_Text);
-
-      if (EC) {
-        errs() << "Error opening file: " << EC.message() << "\n";
+      if (errorPoints.empty())
         return false;
-      }
 
-      
-    while (std::any_of(S.begin(), S.end(), [](bool visited) { return !visited; })) {
-        
-        int CEI = -1;
-        for (size_t i = 0; i < S.size(); ++i) {
-            if (!S[i]) {
-                CEI = i;
-                break;  
-            }
-        }
-
-        if (CEI == -1) {
-            break;  
-        }
-
-        S[CEI] = true;  
-        std::vector<Instruction*> P;  
-        for (size_t i = 0; i < bbkSetList.size(); ++i) {
-            if (isSamePath(S[CEI], S[i])) {
-                P.push_back(errorPoints[i]);
-                S[i] = true;
-            } else if (hasCommon(bbkSetList[CEI], bbkSetList[i])) {
-                P.push_back(errorPoints[i]);
-                S[i] = true;
-            }
+      // error points in the same block share one ancestor set
+      DenseMap<BasicBlock*, BitVector> fatherSets;
+      std::vector<int> owner(blockIds.size(), -1);
+      IntEqClasses clusters(errorPoints.size());
+      for (unsigned i = 0; i < errorPoints.size(); ++i) {
+        BasicBlock *BB = errorPoints[i]->getParent();
+        auto it = fatherSets.find(BB);
+        if (it == fatherSets.end())
+          it = fatherSets.insert({BB, getFatherSet(BB, blockIds, k)}).first;
+
+        for (unsigned id : it->second.set_bits()) {
+          if (owner[id] < 0)
+            owner[id] = i;
+          else
+            clusters.join(owner[id], i);
         }
+      }
+      clusters.compress();
 
-        EPC.push_back(P);  
-    }
-
+      std::vector<std::vector<Instruction*>> EPC(clusters.getNumClasses());
+      for (unsigned i = 0; i < errorPoints.size(); ++i)
+        EPC[clusters[i]].push_back(errorPoints[i]);
 
-     
       for (auto& cluster : EPC) {
-        output << "Cluster:\n";
+        *output << "Cluster:\n";
         for (auto& instr : cluster) {
-          output << "Error point: " << *instr << "\n";
+          // file:line prefix lets GlobalCFGDistancePass read targets back
+          const DebugLoc &Loc = instr->getDebugLoc();
+          *output << "Error point: " << Loc->getFilename() << ":"
+                  << Loc.getLine() << ": " << *instr << "\n";
         }
       }
 
-      return false;  
+      return false;
     }
   };
 }
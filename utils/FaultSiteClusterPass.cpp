@@ -0,0 +1,398 @@
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/IntEqClasses.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+cl::opt<std::string> FaultSiteFile(
+    "fault-site-file",
+    cl::desc("Fault sites written by ErrorFinder (.faultsite)"),
+    cl::value_desc("filename"));
+
+cl::opt<std::string> ClusterOutputFile(
+    "fault-cluster-output", cl::desc("Output file for the clusters"),
+    cl::value_desc("filename"), cl::init("fault_clusters.json"));
+
+enum ClusterEngine { CE_Ancestor, CE_Dominator };
+
+cl::opt<ClusterEngine> ClusterEngineKind(
+    "fault-cluster-engine", cl::desc("How fault sites are grouped"),
+    cl::values(clEnumValN(CE_Ancestor, "ancestor",
+                          "shared block within -fault-cluster-k predecessors"),
+               clEnumValN(CE_Dominator, "dominator",
+                          "nearest common (post)dominator within "
+                          "-fault-cluster-dom-depth levels")),
+    cl::init(CE_Ancestor));
+
+cl::opt<unsigned> ClusterDepth(
+    "fault-cluster-k",
+    cl::desc("Maximum depth of the predecessor walk from a fault site"),
+    cl::init(3));
+
+cl::opt<unsigned> ClusterDomDepth(
+    "fault-cluster-dom-depth",
+    cl::desc("Maximum levels between a fault site and the nearest common "
+             "(post)dominator of its cluster"),
+    cl::init(2));
+
+// One entry of the .faultsite "info" array. A site is located by the nth
+// call (serialNumber, from 1) of calleeName in functionName, counted the way
+// FaultSiteAnalysis numbers them.
+struct FaultSite {
+  std::string FileName;
+  std::string FunctionName;
+  std::string CalleeName;
+  int SerialNumber = 0;
+  int LineNumber = 0;
+  Instruction *Inst = nullptr;
+};
+
+// boost::property_tree writes every value as a string
+Optional<int64_t> getInteger(const json::Object &Obj, StringRef Key) {
+  if (Optional<int64_t> Value = Obj.getInteger(Key))
+    return Value;
+  int64_t Value;
+  if (Optional<StringRef> Text = Obj.getString(Key))
+    if (!Text->trim().getAsInteger(10, Value))
+      return Value;
+  return None;
+}
+
+bool readFaultSites(StringRef Path, std::vector<FaultSite> &Sites) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+  if (!Buf) {
+    errs() << "Error: Unable to read fault sites " << Path << ": "
+           << Buf.getError().message() << "\n";
+    return false;
+  }
+
+  Expected<json::Value> Root = json::parse((*Buf)->getBuffer());
+  if (!Root) {
+    errs() << "Error: " << Path << ": " << toString(Root.takeError()) << "\n";
+    return false;
+  }
+  const json::Object *Obj = Root->getAsObject();
+  const json::Array *Info = Obj ? Obj->getArray("info") : nullptr;
+  if (!Info) {
+    errs() << "Error: " << Path << ": no \"info\" array\n";
+    return false;
+  }
+
+  for (const json::Value &Item : *Info) {
+    const json::Object *Site = Item.getAsObject();
+    const json::Object *Callee =
+        Site ? Site->getObject("faultSiteInfo") : nullptr;
+    if (!Callee)
+      continue;
+    Optional<StringRef> File = Site->getString("fileName");
+    Optional<StringRef> Function = Site->getString("functionName");
+    Optional<StringRef> CalleeName = Callee->getString("calleeName");
+    Optional<int64_t> Serial = getInteger(*Site, "serialNumber");
+    if (!File || !Function || !CalleeName || !Serial || *Serial <= 0)
+      continue;
+
+    FaultSite S;
+    S.FileName = File->str();
+    S.FunctionName = Function->str();
+    S.CalleeName = CalleeName->str();
+    S.SerialNumber = *Serial;
+    S.LineNumber = getInteger(*Site, "lineNumber").getValueOr(0);
+    Sites.push_back(std::move(S));
+  }
+  return true;
+}
+
+json::Object siteToJSON(const FaultSite &S) {
+  return json::Object{{"fileName", S.FileName},
+                      {"functionName", S.FunctionName},
+                      {"calleeName", S.CalleeName},
+                      {"serialNumber", S.SerialNumber},
+                      {"lineNumber", S.LineNumber}};
+}
+
+// Clusters all fault sites of a module in one run. Sites are bound to
+// their call instructions, then grouped per function: two sites share a
+// cluster when their k-deep predecessor sets share a block, as in
+// ErrorPointCluster. Each cluster is written with an id derived from its
+// representative (first) site, so ids stay the same across runs and
+// modules as long as that site does.
+//
+// The dominator engine instead joins sites whose nearest common dominator
+// or nearest common post-dominator is at most -fault-cluster-dom-depth
+// levels above both. Each site claims its (post)dominators up to that many
+// levels, so a function with n sites costs O(n * depth) plus the tree
+// build, not O(n^2) queries.
+class FaultSiteClusterPass : public PassInfoMixin<FaultSiteClusterPass> {
+public:
+  FaultSiteClusterPass(std::string SitesFile, std::string OutputFile,
+                       ClusterEngine Engine, unsigned Depth,
+                       unsigned DomDepth)
+      : SitesFile(std::move(SitesFile)), OutputFile(std::move(OutputFile)),
+        Engine(Engine), Depth(Depth), DomDepth(DomDepth) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &) {
+    std::vector<FaultSite> Sites;
+    if (!readFaultSites(SitesFile, Sites))
+      return PreservedAnalyses::all();
+
+    std::map<std::string, std::vector<unsigned>> FunctionSites;
+    for (unsigned Idx = 0; Idx < Sites.size(); Idx++)
+      FunctionSites[Sites[Idx].FunctionName].push_back(Idx);
+
+    std::vector<std::vector<unsigned>> Clusters;
+    unsigned Found = 0;
+    for (auto &Entry : FunctionSites) {
+      Function *F = M.getFunction(Entry.first);
+      if (!F || F->isDeclaration())
+        continue;
+      std::vector<unsigned> Located = locateSites(*F, Sites, Entry.second);
+      Found += Located.size();
+      if (Located.empty())
+        continue;
+      if (Engine == CE_Dominator)
+        clusterByDominators(*F, Sites, Located, Clusters);
+      else
+        clusterByAncestors(*F, Sites, Located, Clusters);
+    }
+
+    if (Found < Sites.size())
+      errs() << "Note: " << Sites.size() - Found << " of " << Sites.size()
+             << " fault sites are not in " << M.getName() << "\n";
+
+    if (!writeClusters(Sites, Clusters))
+      errs() << "Error: Unable to open output file.\n";
+    return PreservedAnalyses::all();
+  }
+
+private:
+  std::string SitesFile;
+  std::string OutputFile;
+  ClusterEngine Engine;
+  unsigned Depth;
+  unsigned DomDepth;
+
+  // Binds the sites of F to their call instructions and returns the bound
+  // ones in instruction order. Sites recorded for a same-named static
+  // function of another file are left alone.
+  std::vector<unsigned> locateSites(Function &F,
+                                    std::vector<FaultSite> &Sites,
+                                    const std::vector<unsigned> &Indices) {
+    std::vector<unsigned> Located;
+    const DISubprogram *SP = F.getSubprogram();
+    if (!SP)
+      return Located;
+
+    std::map<std::pair<std::string, int>, unsigned> Wanted;
+    for (unsigned Idx : Indices)
+      if (Sites[Idx].FileName == SP->getFilename())
+        Wanted[{Sites[Idx].CalleeName, Sites[Idx].SerialNumber}] = Idx;
+    if (Wanted.empty())
+      return Located;
+
+    StringMap<int> Serials;
+    for (BasicBlock &BB : F) {
+      for (Instruction &I : BB) {
+        auto *Call = dyn_cast<CallInst>(&I);
+        Function *Callee = Call ? Call->getCalledFunction() : nullptr;
+        if (!Callee || !I.getDebugLoc())
+          continue;
+        Type *RetTy = Callee->getReturnType();
+        if (!RetTy->isIntegerTy() && !RetTy->isPointerTy())
+          continue;
+        int Serial = ++Serials[Callee->getName()];
+        auto It = Wanted.find({Callee->getName().str(), Serial});
+        if (It == Wanted.end())
+          continue;
+        Sites[It->second].Inst = &I;
+        Located.push_back(It->second);
+      }
+    }
+    return Located;
+  }
+
+  void clusterByAncestors(Function &F, const std::vector<FaultSite> &Sites,
+                          const std::vector<unsigned> &Located,
+                          std::vector<std::vector<unsigned>> &Clusters) {
+    DenseMap<BasicBlock *, unsigned> BlockIds;
+    for (BasicBlock &BB : F) {
+      unsigned Id = BlockIds.size();
+      BlockIds[&BB] = Id;
+    }
+
+    DenseMap<BasicBlock *, BitVector> Ancestors;
+    std::vector<int> Owner(BlockIds.size(), -1);
+    IntEqClasses Classes(Located.size());
+    for (unsigned I = 0; I < Located.size(); I++) {
+      BasicBlock *BB = Sites[Located[I]].Inst->getParent();
+      auto It = Ancestors.find(BB);
+      if (It == Ancestors.end())
+        It = Ancestors.insert({BB, getAncestors(BB, BlockIds)}).first;
+      for (unsigned Id : It->second.set_bits()) {
+        if (Owner[Id] < 0)
+          Owner[Id] = I;
+        else
+          Classes.join(Owner[Id], I);
+      }
+    }
+    appendClusters(Located, Classes, Clusters);
+  }
+
+  void clusterByDominators(Function &F, const std::vector<FaultSite> &Sites,
+                           const std::vector<unsigned> &Located,
+                           std::vector<std::vector<unsigned>> &Clusters) {
+    DominatorTree DT(F);
+    PostDominatorTree PDT(F);
+    IntEqClasses Classes(Located.size());
+
+    std::vector<DomTreeNode *> Nodes(Located.size());
+    for (unsigned I = 0; I < Located.size(); I++)
+      Nodes[I] = DT.getNode(Sites[Located[I]].Inst->getParent());
+    joinNearby(Nodes, Classes);
+
+    for (unsigned I = 0; I < Located.size(); I++)
+      Nodes[I] = PDT.getNode(Sites[Located[I]].Inst->getParent());
+    joinNearby(Nodes, Classes);
+
+    appendClusters(Located, Classes, Clusters);
+  }
+
+  // Two sites have their nearest common ancestor within DomDepth levels of
+  // both exactly when both reach some node in at most DomDepth steps up
+  // the tree, so every site joins the first one to claim any such node.
+  // Nodes may be null for unreachable blocks; those sites stay alone. The
+  // virtual root joining the exits of a post-dominator tree has no block
+  // and is not a common post-dominator, so the walk stops below it.
+  void joinNearby(const std::vector<DomTreeNode *> &Nodes,
+                  IntEqClasses &Classes) {
+    DenseMap<DomTreeNode *, unsigned> Owner;
+    for (unsigned I = 0; I < Nodes.size(); I++) {
+      DomTreeNode *Current = Nodes[I];
+      for (unsigned Level = 0;
+           Current && Current->getBlock() && Level <= DomDepth; Level++) {
+        auto Claimed = Owner.try_emplace(Current, I);
+        if (!Claimed.second)
+          Classes.join(Claimed.first->second, I);
+        Current = Current->getIDom();
+      }
+    }
+  }
+
+  static void appendClusters(const std::vector<unsigned> &Located,
+                             IntEqClasses &Classes,
+                             std::vector<std::vector<unsigned>> &Clusters) {
+    Classes.compress();
+    size_t First = Clusters.size();
+    Clusters.resize(First + Classes.getNumClasses());
+    for (unsigned I = 0; I < Located.size(); I++)
+      Clusters[First + Classes[I]].push_back(Located[I]);
+  }
+
+  BitVector getAncestors(BasicBlock *BB,
+                         const DenseMap<BasicBlock *, unsigned> &BlockIds) {
+    // unlike ErrorPointCluster, a site's own block counts, so sites in one
+    // block always share a cluster
+    BitVector Ancestors(BlockIds.size());
+    Ancestors.set(BlockIds.lookup(BB));
+    std::vector<BasicBlock *> CurrentLevel = {BB};
+    for (unsigned Level = 0; Level < Depth && !CurrentLevel.empty();
+         Level++) {
+      std::vector<BasicBlock *> NextLevel;
+      for (BasicBlock *Current : CurrentLevel) {
+        for (BasicBlock *Pred : predecessors(Current)) {
+          unsigned Id = BlockIds.lookup(Pred);
+          if (!Ancestors.test(Id)) {
+            Ancestors.set(Id);
+            NextLevel.push_back(Pred);
+          }
+        }
+      }
+      CurrentLevel.swap(NextLevel);
+    }
+    return Ancestors;
+  }
+
+  static std::string clusterId(const FaultSite &Representative) {
+    std::string Key = Representative.FileName + ":" +
+                      Representative.FunctionName + ":" +
+                      Representative.CalleeName + ":" +
+                      std::to_string(Representative.SerialNumber);
+    std::string Id;
+    raw_string_ostream OS(Id);
+    OS << format_hex_no_prefix(xxHash64(Key), 16);
+    return OS.str();
+  }
+
+  bool writeClusters(const std::vector<FaultSite> &Sites,
+                     const std::vector<std::vector<unsigned>> &Clusters) {
+    std::error_code EC;
+    raw_fd_ostream OS(OutputFile, EC, sys::fs::OF_Text);
+    if (EC)
+      return false;
+
+    json::OStream J(OS, 2);
+    J.object([&] {
+      J.attributeArray("clusters", [&] {
+        for (const std::vector<unsigned> &Cluster : Clusters) {
+          const FaultSite &Representative = Sites[Cluster.front()];
+          J.object([&] {
+            J.attribute("id", clusterId(Representative));
+            J.attribute("representative", siteToJSON(Representative));
+            J.attributeArray("sites", [&] {
+              for (unsigned Idx : Cluster)
+                J.value(siteToJSON(Sites[Idx]));
+            });
+          });
+        }
+      });
+    });
+    OS << "\n";
+    return true;
+  }
+};
+
+} // namespace
+
+llvm::PassPluginLibraryInfo getFaultSiteClusterPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "FaultSiteClusterPass", LLVM_VERSION_STRING,
+          [](PassBuilder &PB) {
+            PB.registerPipelineParsingCallback(
+                [](StringRef Name, ModulePassManager &MPM,
+                   ArrayRef<PassBuilder::PipelineElement>) {
+                  if (Name == "fault-site-cluster") {
+                    MPM.addPass(FaultSiteClusterPass(
+                        FaultSiteFile, ClusterOutputFile, ClusterEngineKind,
+                        ClusterDepth, ClusterDomDepth));
+                    return true;
+                  }
+                  return false;
+                });
+          }};
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo
+llvmGetPassPluginInfo() {
+  return getFaultSiteClusterPassPluginInfo();
+}
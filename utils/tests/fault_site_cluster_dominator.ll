@@ -0,0 +1,120 @@
+; RUN: echo '{"info": [ \
+; RUN:   {"fileName": "cluster.c", "functionName": "exits", "serialNumber": "1", "faultSiteInfo": {"calleeName": "site"}}, \
+; RUN:   {"fileName": "cluster.c", "functionName": "exits", "serialNumber": "2", "faultSiteInfo": {"calleeName": "site"}}, \
+; RUN:   {"fileName": "cluster.c", "functionName": "siblings", "serialNumber": "1", "faultSiteInfo": {"calleeName": "site"}}, \
+; RUN:   {"fileName": "cluster.c", "functionName": "siblings", "serialNumber": "2", "faultSiteInfo": {"calleeName": "site"}}, \
+; RUN:   {"fileName": "cluster.c", "functionName": "siblings", "serialNumber": "3", "faultSiteInfo": {"calleeName": "site"}}]}' > %t.faultsite
+; RUN: %opt %loadfsc -passes=fault-site-cluster -disable-output %s \
+; RUN:   -fault-site-file=%t.faultsite -fault-cluster-output=%t.json \
+; RUN:   -fault-cluster-engine=dominator -fault-cluster-dom-depth=1
+; RUN: FileCheck %s --check-prefix=DEPTH1 < %t.json
+; RUN: %opt %loadfsc -passes=fault-site-cluster -disable-output %s \
+; RUN:   -fault-site-file=%t.faultsite -fault-cluster-output=%t.json \
+; RUN:   -fault-cluster-engine=dominator -fault-cluster-dom-depth=2
+; RUN: FileCheck %s --check-prefix=DEPTH2 < %t.json
+
+declare i32 @site(i32)
+
+; Two sites right before separate returns. The exits only meet in the
+; virtual root of the post-dominator tree, which does not make them a
+; cluster.
+define i32 @exits(i1 %c) !dbg !4 {
+entry:
+  br i1 %c, label %left, label %right
+left:
+  br label %exit1
+exit1:
+  %a = call i32 @site(i32 1), !dbg !10
+  ret i32 %a
+right:
+  br label %exit2
+exit2:
+  %b = call i32 @site(i32 2), !dbg !11
+  ret i32 %b
+}
+
+; X dominates A and C, B lies four levels under X inside A's subtree. A
+; and C share a cluster from depth 1, B from neither.
+define i32 @siblings(i1 %c) !dbg !5 {
+X:
+  br i1 %c, label %A, label %C
+A:
+  %a = call i32 @site(i32 1), !dbg !12
+  br label %a1
+a1:
+  br label %a2
+a2:
+  br label %B
+B:
+  %b = call i32 @site(i32 2), !dbg !13
+  br label %b1
+b1:
+  br label %retB
+retB:
+  ret i32 %b
+C:
+  %cc = call i32 @site(i32 3), !dbg !14
+  br label %c1
+c1:
+  br label %retC
+retC:
+  ret i32 %cc
+}
+
+; Clusters are written function by function, in the order of their first
+; site. A site closing with `}` right before `]` ends its cluster.
+; DEPTH1-LABEL: "clusters"
+; DEPTH1:      "sites": [
+; DEPTH1:      "serialNumber": 1
+; DEPTH1-NEXT: }
+; DEPTH1-NEXT: ]
+; DEPTH1:      "sites": [
+; DEPTH1:      "serialNumber": 2
+; DEPTH1-NEXT: }
+; DEPTH1-NEXT: ]
+; DEPTH1:      "sites": [
+; DEPTH1:      "serialNumber": 1
+; DEPTH1-NEXT: },
+; DEPTH1-NOT:  ]
+; DEPTH1:      "serialNumber": 3
+; DEPTH1-NEXT: }
+; DEPTH1-NEXT: ]
+; DEPTH1:      "sites": [
+; DEPTH1:      "serialNumber": 2
+; DEPTH1-NEXT: }
+; DEPTH1-NEXT: ]
+
+; At depth 2 both exits are two levels below the entry block.
+; DEPTH2-LABEL: "clusters"
+; DEPTH2:      "sites": [
+; DEPTH2:      "serialNumber": 1
+; DEPTH2-NEXT: },
+; DEPTH2-NOT:  ]
+; DEPTH2:      "serialNumber": 2
+; DEPTH2-NEXT: }
+; DEPTH2-NEXT: ]
+; DEPTH2:      "sites": [
+; DEPTH2:      "serialNumber": 1
+; DEPTH2-NEXT: },
+; DEPTH2-NOT:  ]
+; DEPTH2:      "serialNumber": 3
+; DEPTH2-NEXT: }
+; DEPTH2-NEXT: ]
+; DEPTH2:      "sites": [
+; DEPTH2:      "serialNumber": 2
+; DEPTH2-NEXT: }
+; DEPTH2-NEXT: ]
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2}
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "cluster.c", directory: "/tmp")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !DISubroutineType(types: !{})
+!4 = distinct !DISubprogram(name: "exits", scope: !1, file: !1, line: 1, type: !3, unit: !0)
+!5 = distinct !DISubprogram(name: "siblings", scope: !1, file: !1, line: 10, type: !3, unit: !0)
+!10 = !DILocation(line: 2, column: 3, scope: !4)
+!11 = !DILocation(line: 3, column: 3, scope: !4)
+!12 = !DILocation(line: 11, column: 3, scope: !5)
+!13 = !DILocation(line: 12, column: 3, scope: !5)
+!14 = !DILocation(line: 13, column: 3, scope: !5)
@@ -0,0 +1,32 @@
+# Regression tests of the utils passes on hand-written IR. The passes have
+# no build of their own, so point lit at the built plugins:
+#
+#   lit -sv --param fault_site_cluster=/path/to/FaultSiteClusterPass.so utils/tests
+#
+# opt and FileCheck come from the LLVM that llvm-config (or the llvm_config
+# parameter) names.
+
+import os
+import subprocess
+
+import lit.formats
+
+config.name = 'HuntFUZZ utils'
+config.test_format = lit.formats.ShTest(True)
+config.suffixes = ['.ll']
+config.test_source_root = os.path.dirname(__file__)
+
+llvm_config = lit_config.params.get('llvm_config', 'llvm-config')
+llvm_bindir = subprocess.check_output([llvm_config, '--bindir'], text=True).strip()
+config.environment['PATH'] = os.pathsep.join(
+    [llvm_bindir, config.environment.get('PATH', os.environ.get('PATH', ''))])
+
+fault_site_cluster = lit_config.params.get('fault_site_cluster')
+if not fault_site_cluster:
+    lit_config.fatal('pass --param fault_site_cluster=<FaultSiteClusterPass.so>')
+fault_site_cluster = os.path.abspath(fault_site_cluster)
+
+config.substitutions.append(('%opt', os.path.join(llvm_bindir, 'opt')))
+# -load registers the pass options before the command line is parsed
+config.substitutions.append(
+    ('%loadfsc', '-load %s -load-pass-plugin %s' % (fault_site_cluster, fault_site_cluster)))